@@ -6,8 +6,8 @@
 using namespace Rcpp;
 
 // generate_video_rcpp
-int generate_video_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader, int width, int height, int type, bool verbose, float step, int frames, CharacterVector filename);
-RcppExport SEXP _shadr_generate_video_rcpp(SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP widthSEXP, SEXP heightSEXP, SEXP typeSEXP, SEXP verboseSEXP, SEXP stepSEXP, SEXP framesSEXP, SEXP filenameSEXP) {
+SEXP generate_video_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader, int width, int height, int type, bool verbose, double start, double step, int frames, NumericVector times, IntegerVector numbers, CharacterVector filename, int backend, int readback_buffers, int encode_threads, int png_level, int png_filter, int compress_threads, CharacterVector pipe_command, SEXP callback, double framerate, int yuv_range, int array_type, bool offline);
+RcppExport SEXP _shadr_generate_video_rcpp(SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP widthSEXP, SEXP heightSEXP, SEXP typeSEXP, SEXP verboseSEXP, SEXP startSEXP, SEXP stepSEXP, SEXP framesSEXP, SEXP timesSEXP, SEXP numbersSEXP, SEXP filenameSEXP, SEXP backendSEXP, SEXP readback_buffersSEXP, SEXP encode_threadsSEXP, SEXP png_levelSEXP, SEXP png_filterSEXP, SEXP compress_threadsSEXP, SEXP pipe_commandSEXP, SEXP callbackSEXP, SEXP framerateSEXP, SEXP yuv_rangeSEXP, SEXP array_typeSEXP, SEXP offlineSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -17,10 +17,25 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type height(heightSEXP);
     Rcpp::traits::input_parameter< int >::type type(typeSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
-    Rcpp::traits::input_parameter< float >::type step(stepSEXP);
+    Rcpp::traits::input_parameter< double >::type start(startSEXP);
+    Rcpp::traits::input_parameter< double >::type step(stepSEXP);
     Rcpp::traits::input_parameter< int >::type frames(framesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type numbers(numbersSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type filename(filenameSEXP);
-    rcpp_result_gen = Rcpp::wrap(generate_video_rcpp(vertex_shader, fragment_shader, width, height, type, verbose, step, frames, filename));
+    Rcpp::traits::input_parameter< int >::type backend(backendSEXP);
+    Rcpp::traits::input_parameter< int >::type readback_buffers(readback_buffersSEXP);
+    Rcpp::traits::input_parameter< int >::type encode_threads(encode_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type png_level(png_levelSEXP);
+    Rcpp::traits::input_parameter< int >::type png_filter(png_filterSEXP);
+    Rcpp::traits::input_parameter< int >::type compress_threads(compress_threadsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type pipe_command(pipe_commandSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type callback(callbackSEXP);
+    Rcpp::traits::input_parameter< double >::type framerate(framerateSEXP);
+    Rcpp::traits::input_parameter< int >::type yuv_range(yuv_rangeSEXP);
+    Rcpp::traits::input_parameter< int >::type array_type(array_typeSEXP);
+    Rcpp::traits::input_parameter< bool >::type offline(offlineSEXP);
+    rcpp_result_gen = Rcpp::wrap(generate_video_rcpp(vertex_shader, fragment_shader, width, height, type, verbose, start, step, frames, times, numbers, filename, backend, readback_buffers, encode_threads, png_level, png_filter, compress_threads, pipe_command, callback, framerate, yuv_range, array_type, offline));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -41,8 +56,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // open_window_image_rcpp
-int open_window_image_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader, int width, int height, bool verbose, NumericMatrix& r_layer, NumericMatrix& g_layer, NumericMatrix& b_layer);
-RcppExport SEXP _shadr_open_window_image_rcpp(SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP widthSEXP, SEXP heightSEXP, SEXP verboseSEXP, SEXP r_layerSEXP, SEXP g_layerSEXP, SEXP b_layerSEXP) {
+int open_window_image_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader, int width, int height, bool verbose, const NumericVector image);
+RcppExport SEXP _shadr_open_window_image_rcpp(SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP widthSEXP, SEXP heightSEXP, SEXP verboseSEXP, SEXP imageSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -51,18 +66,220 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type width(widthSEXP);
     Rcpp::traits::input_parameter< int >::type height(heightSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix& >::type r_layer(r_layerSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix& >::type g_layer(g_layerSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix& >::type b_layer(b_layerSEXP);
-    rcpp_result_gen = Rcpp::wrap(open_window_image_rcpp(vertex_shader, fragment_shader, width, height, verbose, r_layer, g_layer, b_layer));
+    Rcpp::traits::input_parameter< const NumericVector >::type image(imageSEXP);
+    rcpp_result_gen = Rcpp::wrap(open_window_image_rcpp(vertex_shader, fragment_shader, width, height, verbose, image));
+    return rcpp_result_gen;
+END_RCPP
+}
+// checksum_check_rcpp
+DataFrame checksum_check_rcpp(int max_length);
+RcppExport SEXP _shadr_checksum_check_rcpp(SEXP max_lengthSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type max_length(max_lengthSEXP);
+    rcpp_result_gen = Rcpp::wrap(checksum_check_rcpp(max_length));
+    return rcpp_result_gen;
+END_RCPP
+}
+// png_filter_check_rcpp
+DataFrame png_filter_check_rcpp(int max_width);
+RcppExport SEXP _shadr_png_filter_check_rcpp(SEXP max_widthSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type max_width(max_widthSEXP);
+    rcpp_result_gen = Rcpp::wrap(png_filter_check_rcpp(max_width));
+    return rcpp_result_gen;
+END_RCPP
+}
+// open_session_rcpp
+SEXP open_session_rcpp(int width, int height, int backend, bool verbose, int cache_size);
+RcppExport SEXP _shadr_open_session_rcpp(SEXP widthSEXP, SEXP heightSEXP, SEXP backendSEXP, SEXP verboseSEXP, SEXP cache_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type width(widthSEXP);
+    Rcpp::traits::input_parameter< int >::type height(heightSEXP);
+    Rcpp::traits::input_parameter< int >::type backend(backendSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< int >::type cache_size(cache_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(open_session_rcpp(width, height, backend, verbose, cache_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// render_session_rcpp
+SEXP render_session_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, int type, double start, double step, int frames, NumericVector times, IntegerVector numbers, CharacterVector filename, int readback_buffers, int encode_threads, int png_level, int png_filter, int compress_threads, CharacterVector pipe_command, SEXP callback, double framerate, int yuv_range, int array_type, bool offline);
+RcppExport SEXP _shadr_render_session_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP typeSEXP, SEXP startSEXP, SEXP stepSEXP, SEXP framesSEXP, SEXP timesSEXP, SEXP numbersSEXP, SEXP filenameSEXP, SEXP readback_buffersSEXP, SEXP encode_threadsSEXP, SEXP png_levelSEXP, SEXP png_filterSEXP, SEXP compress_threadsSEXP, SEXP pipe_commandSEXP, SEXP callbackSEXP, SEXP framerateSEXP, SEXP yuv_rangeSEXP, SEXP array_typeSEXP, SEXP offlineSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< double >::type start(startSEXP);
+    Rcpp::traits::input_parameter< double >::type step(stepSEXP);
+    Rcpp::traits::input_parameter< int >::type frames(framesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type numbers(numbersSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< int >::type readback_buffers(readback_buffersSEXP);
+    Rcpp::traits::input_parameter< int >::type encode_threads(encode_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type png_level(png_levelSEXP);
+    Rcpp::traits::input_parameter< int >::type png_filter(png_filterSEXP);
+    Rcpp::traits::input_parameter< int >::type compress_threads(compress_threadsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type pipe_command(pipe_commandSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type callback(callbackSEXP);
+    Rcpp::traits::input_parameter< double >::type framerate(framerateSEXP);
+    Rcpp::traits::input_parameter< int >::type yuv_range(yuv_rangeSEXP);
+    Rcpp::traits::input_parameter< int >::type array_type(array_typeSEXP);
+    Rcpp::traits::input_parameter< bool >::type offline(offlineSEXP);
+    rcpp_result_gen = Rcpp::wrap(render_session_rcpp(session, vertex_shader, fragment_shader, type, start, step, frames, times, numbers, filename, readback_buffers, encode_threads, png_level, png_filter, compress_threads, pipe_command, callback, framerate, yuv_range, array_type, offline));
+    return rcpp_result_gen;
+END_RCPP
+}
+// render_tiled_rcpp
+bool render_tiled_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, int type, float time, int width, int height, CharacterVector filename);
+RcppExport SEXP _shadr_render_tiled_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP typeSEXP, SEXP timeSEXP, SEXP widthSEXP, SEXP heightSEXP, SEXP filenameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< float >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< int >::type width(widthSEXP);
+    Rcpp::traits::input_parameter< int >::type height(heightSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filename(filenameSEXP);
+    rcpp_result_gen = Rcpp::wrap(render_tiled_rcpp(session, vertex_shader, fragment_shader, type, time, width, height, filename));
+    return rcpp_result_gen;
+END_RCPP
+}
+// render_float_rcpp
+SEXP render_float_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, int type, float time, bool half, CharacterVector filename);
+RcppExport SEXP _shadr_render_float_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP typeSEXP, SEXP timeSEXP, SEXP halfSEXP, SEXP filenameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< float >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< bool >::type half(halfSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filename(filenameSEXP);
+    rcpp_result_gen = Rcpp::wrap(render_float_rcpp(session, vertex_shader, fragment_shader, type, time, half, filename));
+    return rcpp_result_gen;
+END_RCPP
+}
+// render_stats_rcpp
+List render_stats_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, int type, float time, bool half, int bins, float hist_min, float hist_max);
+RcppExport SEXP _shadr_render_stats_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP typeSEXP, SEXP timeSEXP, SEXP halfSEXP, SEXP binsSEXP, SEXP hist_minSEXP, SEXP hist_maxSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< float >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< bool >::type half(halfSEXP);
+    Rcpp::traits::input_parameter< int >::type bins(binsSEXP);
+    Rcpp::traits::input_parameter< float >::type hist_min(hist_minSEXP);
+    Rcpp::traits::input_parameter< float >::type hist_max(hist_maxSEXP);
+    rcpp_result_gen = Rcpp::wrap(render_stats_rcpp(session, vertex_shader, fragment_shader, type, time, half, bins, hist_min, hist_max));
+    return rcpp_result_gen;
+END_RCPP
+}
+// render_sweep_rcpp
+SEXP render_sweep_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, int type, DataFrame params, CharacterVector filename, int readback_buffers, int encode_threads, int png_level, int png_filter, int compress_threads, int array_type);
+RcppExport SEXP _shadr_render_sweep_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP typeSEXP, SEXP paramsSEXP, SEXP filenameSEXP, SEXP readback_buffersSEXP, SEXP encode_threadsSEXP, SEXP png_levelSEXP, SEXP png_filterSEXP, SEXP compress_threadsSEXP, SEXP array_typeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< int >::type readback_buffers(readback_buffersSEXP);
+    Rcpp::traits::input_parameter< int >::type encode_threads(encode_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type png_level(png_levelSEXP);
+    Rcpp::traits::input_parameter< int >::type png_filter(png_filterSEXP);
+    Rcpp::traits::input_parameter< int >::type compress_threads(compress_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type array_type(array_typeSEXP);
+    rcpp_result_gen = Rcpp::wrap(render_sweep_rcpp(session, vertex_shader, fragment_shader, type, params, filename, readback_buffers, encode_threads, png_level, png_filter, compress_threads, array_type));
+    return rcpp_result_gen;
+END_RCPP
+}
+// close_session_rcpp
+void close_session_rcpp(SEXP session);
+RcppExport SEXP _shadr_close_session_rcpp(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    close_session_rcpp(session);
+    return R_NilValue;
+END_RCPP
+}
+// session_cache_stats_rcpp
+List session_cache_stats_rcpp(SEXP session);
+RcppExport SEXP _shadr_session_cache_stats_rcpp(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(session_cache_stats_rcpp(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// set_binary_cache_dir_rcpp
+CharacterVector set_binary_cache_dir_rcpp(CharacterVector dir);
+RcppExport SEXP _shadr_set_binary_cache_dir_rcpp(SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type dir(dirSEXP);
+    rcpp_result_gen = Rcpp::wrap(set_binary_cache_dir_rcpp(dir));
+    return rcpp_result_gen;
+END_RCPP
+}
+// evaluate_grid_rcpp
+NumericMatrix evaluate_grid_rcpp(SEXP session, const CharacterVector vertex_shader, const CharacterVector fragment_shader, List inputs, int nrow, int ncol);
+RcppExport SEXP _shadr_evaluate_grid_rcpp(SEXP sessionSEXP, SEXP vertex_shaderSEXP, SEXP fragment_shaderSEXP, SEXP inputsSEXP, SEXP nrowSEXP, SEXP ncolSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type vertex_shader(vertex_shaderSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector >::type fragment_shader(fragment_shaderSEXP);
+    Rcpp::traits::input_parameter< List >::type inputs(inputsSEXP);
+    Rcpp::traits::input_parameter< int >::type nrow(nrowSEXP);
+    Rcpp::traits::input_parameter< int >::type ncol(ncolSEXP);
+    rcpp_result_gen = Rcpp::wrap(evaluate_grid_rcpp(session, vertex_shader, fragment_shader, inputs, nrow, ncol));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_shadr_generate_video_rcpp", (DL_FUNC) &_shadr_generate_video_rcpp, 9},
+    {"_shadr_generate_video_rcpp", (DL_FUNC) &_shadr_generate_video_rcpp, 24},
     {"_shadr_open_window_rcpp", (DL_FUNC) &_shadr_open_window_rcpp, 6},
-    {"_shadr_open_window_image_rcpp", (DL_FUNC) &_shadr_open_window_image_rcpp, 8},
+    {"_shadr_open_window_image_rcpp", (DL_FUNC) &_shadr_open_window_image_rcpp, 6},
+    {"_shadr_checksum_check_rcpp", (DL_FUNC) &_shadr_checksum_check_rcpp, 1},
+    {"_shadr_png_filter_check_rcpp", (DL_FUNC) &_shadr_png_filter_check_rcpp, 1},
+    {"_shadr_open_session_rcpp", (DL_FUNC) &_shadr_open_session_rcpp, 5},
+    {"_shadr_render_session_rcpp", (DL_FUNC) &_shadr_render_session_rcpp, 21},
+    {"_shadr_render_tiled_rcpp", (DL_FUNC) &_shadr_render_tiled_rcpp, 8},
+    {"_shadr_render_float_rcpp", (DL_FUNC) &_shadr_render_float_rcpp, 7},
+    {"_shadr_render_stats_rcpp", (DL_FUNC) &_shadr_render_stats_rcpp, 9},
+    {"_shadr_render_sweep_rcpp", (DL_FUNC) &_shadr_render_sweep_rcpp, 12},
+    {"_shadr_close_session_rcpp", (DL_FUNC) &_shadr_close_session_rcpp, 1},
+    {"_shadr_session_cache_stats_rcpp", (DL_FUNC) &_shadr_session_cache_stats_rcpp, 1},
+    {"_shadr_set_binary_cache_dir_rcpp", (DL_FUNC) &_shadr_set_binary_cache_dir_rcpp, 1},
+    {"_shadr_evaluate_grid_rcpp", (DL_FUNC) &_shadr_evaluate_grid_rcpp, 6},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,289 @@
+#include "checksum.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHADR_X86_SIMD
+#include <immintrin.h>
+#endif
+
+//Largest n such that 255n(n+1)/2 + (n+1)(65521-1) fits in 32 bits (from zlib)
+#define ADLER_BASE 65521U
+#define ADLER_NMAX 5552
+
+//Slicing-by-8 tables for the reflected 0xEDB88320 polynomial; table[0] is
+//the classic byte-at-a-time table
+struct CrcTables {
+  unsigned int table[8][256];
+  CrcTables() {
+    for(unsigned int n = 0; n < 256; n++) {
+      unsigned int c = n;
+      for(int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      table[0][n] = c;
+    }
+    for(unsigned int n = 0; n < 256; n++) {
+      unsigned int c = table[0][n];
+      for(int k = 1; k < 8; k++) {
+        c = table[0][c & 0xff] ^ (c >> 8);
+        table[k][n] = c;
+      }
+    }
+  }
+};
+
+static const CrcTables& crcTables() {
+  static const CrcTables tables;
+  return(tables);
+}
+
+//Works on the inverted register, like the folding kernel below
+static unsigned int crcSlice8(unsigned int c, const unsigned char* data, size_t len) {
+  const unsigned int (*t)[256] = crcTables().table;
+  while(len >= 8) {
+    unsigned int lo = c ^ ((unsigned int)data[0] | (unsigned int)data[1] << 8 |
+                           (unsigned int)data[2] << 16 | (unsigned int)data[3] << 24);
+    c = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+        t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += 8;
+    len -= 8;
+  }
+  while(len--) {
+    c = t[0][(c ^ *data++) & 0xff] ^ (c >> 8);
+  }
+  return(c);
+}
+
+unsigned int Crc32Scalar(unsigned int crc, const unsigned char* data, size_t len) {
+  return(~crcSlice8(~crc, data, len));
+}
+
+unsigned int Adler32Scalar(unsigned int adler, const unsigned char* data, size_t len) {
+  unsigned int s1 = adler & 0xffff;
+  unsigned int s2 = adler >> 16;
+  while(len > 0) {
+    size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+    len -= n;
+    while(n >= 8) {
+      s1 += data[0]; s2 += s1;
+      s1 += data[1]; s2 += s1;
+      s1 += data[2]; s2 += s1;
+      s1 += data[3]; s2 += s1;
+      s1 += data[4]; s2 += s1;
+      s1 += data[5]; s2 += s1;
+      s1 += data[6]; s2 += s1;
+      s1 += data[7]; s2 += s1;
+      data += 8;
+      n -= 8;
+    }
+    while(n--) {
+      s1 += *data++;
+      s2 += s1;
+    }
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+  }
+  return(s1 | (s2 << 16));
+}
+
+#ifdef SHADR_X86_SIMD
+//Folds 64 bytes at a time with carry-less multiplies, then Barrett-reduces
+//to 32 bits (Gopal et al., "Fast CRC Computation for Generic Polynomials
+//Using PCLMULQDQ", Intel 2009). `len` must be a multiple of 16, at least 64;
+//`c` is the inverted register.
+__attribute__((target("sse4.1,pclmul")))
+static unsigned int crcFold(unsigned int c, const unsigned char* data, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  __m128i x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)c));
+  data += 64;
+  len -= 64;
+
+  //Four independent 128-bit lanes
+  while(len >= 64) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(data + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(data + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(data + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(data + 0x30)));
+    data += 64;
+    len -= 64;
+  }
+
+  //Fold the lanes into one, then any remaining 16 byte blocks into that
+  __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+  while(len >= 16) {
+    x2 = _mm_loadu_si128((const __m128i*)data);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    data += 16;
+    len -= 16;
+  }
+
+  //128 -> 64 bits
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+  //Barrett reduction to 32 bits
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  return((unsigned int)_mm_extract_epi32(x1, 1));
+}
+
+static unsigned int crc32Pclmul(unsigned int crc, const unsigned char* data, size_t len) {
+  unsigned int c = ~crc;
+  if(len >= 64) {
+    size_t folded = len & ~(size_t)15;
+    c = crcFold(c, data, folded);
+    data += folded;
+    len -= folded;
+  }
+  return(~crcSlice8(c, data, len));
+}
+
+//32 bytes per step: s1 sums bytes with _mm_sad_epu8, s2 weights them by
+//32..1 with _mm_maddubs_epi16 and adds 32 * the running s1 for each block
+__attribute__((target("ssse3")))
+static unsigned int adler32Ssse3(unsigned int adler, const unsigned char* data, size_t len) {
+  unsigned int s1 = adler & 0xffff;
+  unsigned int s2 = adler >> 16;
+  const unsigned int block = 32;
+  size_t blocks = len / block;
+  len -= blocks * block;
+
+  const __m128i tap1 = _mm_setr_epi8(32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17);
+  const __m128i tap2 = _mm_setr_epi8(16,15,14,13,12,11,10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  while(blocks > 0) {
+    unsigned int n = ADLER_NMAX / block;
+    if(n > blocks) {
+      n = (unsigned int)blocks;
+    }
+    blocks -= n;
+    __m128i v_ps = _mm_set_epi32(0, 0, 0, (int)(s1 * n));
+    __m128i v_s2 = _mm_set_epi32(0, 0, 0, (int)s2);
+    __m128i v_s1 = _mm_setzero_si128();
+    do {
+      const __m128i bytes1 = _mm_loadu_si128((const __m128i*)data);
+      const __m128i bytes2 = _mm_loadu_si128((const __m128i*)(data + 16));
+      v_ps = _mm_add_epi32(v_ps, v_s1);
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+      v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+      v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+      data += block;
+    } while(--n);
+    v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(2,3,0,1)));
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1,0,3,2)));
+    s1 += (unsigned int)_mm_cvtsi128_si32(v_s1);
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2,3,0,1)));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1,0,3,2)));
+    s2 = (unsigned int)_mm_cvtsi128_si32(v_s2);
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+  }
+  return(Adler32Scalar(s1 | (s2 << 16), data, len));
+}
+#endif
+
+static bool cpuHasPclmul() {
+#ifdef SHADR_X86_SIMD
+  __builtin_cpu_init();
+  return(__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"));
+#else
+  return(false);
+#endif
+}
+
+static bool cpuHasSsse3() {
+#ifdef SHADR_X86_SIMD
+  __builtin_cpu_init();
+  return(__builtin_cpu_supports("ssse3"));
+#else
+  return(false);
+#endif
+}
+
+struct ChecksumDispatch {
+  ChecksumFunction crc32;
+  ChecksumFunction adler32;
+  ChecksumDispatch() : crc32(Crc32Scalar), adler32(Adler32Scalar) {
+#ifdef SHADR_X86_SIMD
+    if(cpuHasPclmul()) {
+      crc32 = crc32Pclmul;
+    }
+    if(cpuHasSsse3()) {
+      adler32 = adler32Ssse3;
+    }
+#endif
+  }
+};
+
+//Encode workers may call these concurrently; function-local statics are
+//initialized exactly once (C++11)
+static const ChecksumDispatch& dispatch() {
+  static const ChecksumDispatch selected;
+  return(selected);
+}
+
+unsigned int Crc32(unsigned int crc, const unsigned char* data, size_t len) {
+  return(dispatch().crc32(crc, data, len));
+}
+
+unsigned int Adler32(unsigned int adler, const unsigned char* data, size_t len) {
+  return(dispatch().adler32(adler, data, len));
+}
+
+std::vector<ChecksumKernel> Crc32Kernels() {
+  std::vector<ChecksumKernel> kernels;
+  ChecksumKernel scalar = {"scalar", Crc32Scalar};
+  kernels.push_back(scalar);
+#ifdef SHADR_X86_SIMD
+  if(cpuHasPclmul()) {
+    ChecksumKernel pclmul = {"pclmul", crc32Pclmul};
+    kernels.push_back(pclmul);
+  }
+#endif
+  return(kernels);
+}
+
+std::vector<ChecksumKernel> Adler32Kernels() {
+  std::vector<ChecksumKernel> kernels;
+  ChecksumKernel scalar = {"scalar", Adler32Scalar};
+  kernels.push_back(scalar);
+#ifdef SHADR_X86_SIMD
+  if(cpuHasSsse3()) {
+    ChecksumKernel ssse3 = {"ssse3", adler32Ssse3};
+    kernels.push_back(ssse3);
+  }
+#endif
+  return(kernels);
+}
@@ -0,0 +1,29 @@
+#ifndef CHECKSUMH
+#define CHECKSUMH
+
+#include <cstddef>
+#include <vector>
+
+//zlib-compatible CRC-32 (PNG chunks) and Adler-32 (zlib stream trailer).
+//Both continue from a previous value, starting from Crc32(0, ...) and
+//Adler32(1, ...) like zlib's crc32()/adler32(). The implementation is picked
+//once per process from the CPU: PCLMULQDQ folding and SSSE3 on x86, with
+//slicing-by-8 and an unrolled scalar loop everywhere else.
+unsigned int Crc32(unsigned int crc, const unsigned char* data, size_t len);
+unsigned int Adler32(unsigned int adler, const unsigned char* data, size_t len);
+
+//The portable versions, always available (used for short inputs and tails)
+unsigned int Crc32Scalar(unsigned int crc, const unsigned char* data, size_t len);
+unsigned int Adler32Scalar(unsigned int adler, const unsigned char* data, size_t len);
+
+//Every implementation of each checksum this CPU can run, the portable one
+//first, so they can all be checked against zlib
+typedef unsigned int (*ChecksumFunction)(unsigned int, const unsigned char*, size_t);
+struct ChecksumKernel {
+  const char* name;
+  ChecksumFunction function;
+};
+std::vector<ChecksumKernel> Crc32Kernels();
+std::vector<ChecksumKernel> Adler32Kernels();
+
+#endif
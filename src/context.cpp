@@ -0,0 +1,285 @@
+#include <Rcpp.h>
+
+#include "context.h"
+#include "fullscreen.h"
+#include <algorithm>
+
+#ifdef SHADR_HAS_EGL
+//Keep X11 out of the EGL headers; it clashes with R's macros
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+//Render sessions can outlive a single call, so GLFW (and the shared EGL
+//display) are only torn down when the last context using them goes away.
+static int glfw_contexts = 0;
+#ifdef SHADR_HAS_EGL
+static int egl_contexts = 0;
+#endif
+//Contexts are only ever used from R's thread
+static RenderContext* current_context = NULL;
+
+static bool InitGLFW() {
+  if(glfw_contexts == 0) {
+    glfwInitHint(GLFW_COCOA_CHDIR_RESOURCES, GLFW_FALSE);
+    if(!glfwInit()){
+      return(false);
+    }
+  }
+  glfw_contexts++;
+  return(true);
+}
+
+static void TerminateGLFW() {
+  if(--glfw_contexts == 0) {
+    glfwTerminate();
+  }
+}
+
+//Offscreen renders only preview in the window, capped at this size
+#define PREVIEW_MAX_WIDTH  1280
+#define PREVIEW_MAX_HEIGHT 720
+
+static bool CreateGLFWContext(RenderContext& context, bool offscreen) {
+  if(!InitGLFW()) {
+    return(false);
+  }
+  int window_width = context.width;
+  int window_height = context.height;
+  if(offscreen) {
+    double scale = std::min(1.0, std::min((double)PREVIEW_MAX_WIDTH / window_width,
+                                          (double)PREVIEW_MAX_HEIGHT / window_height));
+    window_width = std::max(1, (int)(window_width * scale));
+    window_height = std::max(1, (int)(window_height * scale));
+  }
+  //Blitting into a multisampled window is not allowed, and the offscreen
+  //target is single-sampled anyway
+  glfwWindowHint(GLFW_SAMPLES, offscreen ? 0 : 4); // 4x antialiasing
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // We want OpenGL 3.3
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // We don't want the old OpenGL
+  context.window = glfwCreateWindow(window_width, window_height, "shadr", NULL, NULL);
+  if( context.window == NULL ){
+    Rcpp::Rcout << "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n" ;
+    TerminateGLFW();
+    return(false);
+  }
+  glfwMakeContextCurrent(context.window); // Initialize GLEW
+  glewExperimental=true; // Needed in core profile
+  if (glewInit() != GLEW_OK) {
+    Rcpp::Rcout << "Failed to initialize GLEW\n";
+    glfwDestroyWindow(context.window);
+    TerminateGLFW();
+    context.window = NULL;
+    return(false);
+  }
+  InstallGLCallCounters();
+  glfwSetInputMode(context.window, GLFW_STICKY_KEYS, GL_TRUE);
+  return(true);
+}
+
+#ifdef SHADR_HAS_EGL
+//Prefer Mesa's surfaceless platform (llvmpipe on GPU-less machines), then the
+//first EGL device (e.g. headless NVIDIA), then whatever the default display is.
+static EGLDisplay GetHeadlessDisplay() {
+  PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if(eglGetPlatformDisplayEXT) {
+    EGLDisplay display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+                                                  EGL_DEFAULT_DISPLAY, NULL);
+    if(display != EGL_NO_DISPLAY) {
+      return(display);
+    }
+    PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT =
+      (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    if(eglQueryDevicesEXT) {
+      EGLDeviceEXT device;
+      EGLint n_devices = 0;
+      if(eglQueryDevicesEXT(1, &device, &n_devices) && n_devices > 0) {
+        display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+        if(display != EGL_NO_DISPLAY) {
+          return(display);
+        }
+      }
+    }
+  }
+  return(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+}
+
+static bool CreateEGLContext(RenderContext& context, bool verbose) {
+  EGLDisplay display = GetHeadlessDisplay();
+  EGLint major, minor;
+  if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    Rcpp::Rcout << "Failed to initialize EGL display\n";
+    return(false);
+  }
+  context.egl_display = display;
+  egl_contexts++;
+  if(!eglBindAPI(EGL_OPENGL_API)) {
+    Rcpp::Rcout << "EGL display does not support desktop OpenGL\n";
+    DestroyRenderContext(context);
+    return(false);
+  }
+  static const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint n_configs = 0;
+  if(!eglChooseConfig(display, config_attribs, &config, 1, &n_configs) || n_configs < 1) {
+    Rcpp::Rcout << "Failed to find a suitable EGL config\n";
+    DestroyRenderContext(context);
+    return(false);
+  }
+  //Same 3.3 core profile the GLFW path asks for
+  static const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext egl_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if(egl_context == EGL_NO_CONTEXT) {
+    Rcpp::Rcout << "Failed to create OpenGL 3.3 EGL context\n";
+    DestroyRenderContext(context);
+    return(false);
+  }
+  if(!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+    Rcpp::Rcout << "Failed to make surfaceless EGL context current\n";
+    eglDestroyContext(display, egl_context);
+    DestroyRenderContext(context);
+    return(false);
+  }
+  context.egl_context = egl_context;
+  //glewInit() also tries to set up GLX, which fails without an X server;
+  //only the GL entry points are needed here.
+  glewExperimental=true;
+  if (glewContextInit() != GLEW_OK) {
+    Rcpp::Rcout << "Failed to initialize GLEW\n";
+    DestroyRenderContext(context);
+    return(false);
+  }
+  InstallGLCallCounters();
+  if(verbose) {
+    Rcpp::Rcout << "Headless EGL " << major << "." << minor << " context: "
+                << glGetString(GL_RENDERER) << "\n";
+  }
+  return(true);
+}
+#endif
+
+bool CreateRenderContext(RenderContext& context, int width, int height,
+                         int backend, bool verbose, bool offscreen) {
+  context.backend = backend;
+  context.width = width;
+  context.height = height;
+  context.window = NULL;
+  context.egl_display = NULL;
+  context.egl_context = NULL;
+  context.target.framebuffer = 0;
+  context.target.colorbuffer = 0;
+  context.target.depthbuffer = 0;
+  if(backend == SHADR_BACKEND_EGL) {
+#ifdef SHADR_HAS_EGL
+    if(!CreateEGLContext(context, verbose)) {
+      return(false);
+    }
+    //There is no default framebuffer without a window
+    offscreen = true;
+#else
+    Rcpp::Rcout << "shadr was built without EGL support; the headless backend is unavailable\n";
+    return(false);
+#endif
+  } else if(!CreateGLFWContext(context, offscreen)) {
+    return(false);
+  }
+  current_context = &context;
+  if(offscreen && !CreateRenderTarget(context.target, width, height, true)) {
+    DestroyRenderContext(context);
+    return(false);
+  }
+  return(true);
+}
+
+void DestroyRenderContext(RenderContext& context) {
+  DestroyRenderTarget(context.target);
+  if(current_context == &context) {
+    current_context = NULL;
+  }
+  if(context.window) {
+    glfwPollEvents();
+    glfwDestroyWindow(context.window);
+    glfwPollEvents();
+    TerminateGLFW();
+    context.window = NULL;
+  }
+#ifdef SHADR_HAS_EGL
+  if(context.egl_context) {
+    eglMakeCurrent(context.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(context.egl_display, context.egl_context);
+    context.egl_context = NULL;
+  }
+  if(context.egl_display) {
+    if(--egl_contexts == 0) {
+      eglTerminate(context.egl_display);
+    }
+    context.egl_display = NULL;
+  }
+#endif
+}
+
+RenderContext* CurrentRenderContext() {
+  return(current_context);
+}
+
+void MakeRenderContextCurrent(RenderContext& context) {
+  current_context = &context;
+  if(context.window) {
+    glfwMakeContextCurrent(context.window);
+  }
+#ifdef SHADR_HAS_EGL
+  if(context.egl_context) {
+    eglMakeCurrent(context.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, context.egl_context);
+  }
+#endif
+  if(context.target.framebuffer) {
+    BindRenderTarget(context.target);
+  }
+}
+
+void GetRenderSize(const RenderContext& context, int* width, int* height) {
+  if(context.target.framebuffer) {
+    *width = context.target.width;
+    *height = context.target.height;
+  } else {
+    glfwGetFramebufferSize(context.window, width, height);
+  }
+}
+
+void PresentRenderContext(RenderContext& context) {
+  if(context.window) {
+    if(context.target.framebuffer) {
+      BlitRenderTarget(context.target, context.window);
+    } else {
+      glfwSwapBuffers(context.window);
+    }
+  }
+}
+
+void BindPresentedFrame(RenderContext& context) {
+  //Offscreen targets are read directly; windows after the swap
+  if(context.target.framebuffer) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, context.target.framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  } else {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_FRONT);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef CONTEXTH
+#define CONTEXTH
+
+//glew Installed make install
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install
+#include <GLFW/glfw3.h>
+
+#include "render_target.h"
+
+//Context backends (matches the `backend` argument on the R side)
+#define SHADR_BACKEND_GLFW 1
+#define SHADR_BACKEND_EGL  2
+
+//Owns either a GLFW window or a headless EGL context. EGL handles are stored
+//as void* so that the EGL/X11 headers don't leak into files that include Rcpp.
+struct RenderContext {
+  int backend;
+  int width;
+  int height;
+  GLFWwindow* window;
+  void* egl_display;
+  void* egl_context;
+  //Offscreen target frames are rendered into (framebuffer is 0 when drawing
+  //straight to the window). A window, if any, only previews it.
+  RenderTarget target;
+};
+
+//`offscreen` renders into a width x height framebuffer object regardless of
+//window size; the headless backend is always offscreen.
+bool CreateRenderContext(RenderContext& context, int width, int height,
+                         int backend, bool verbose, bool offscreen = false);
+void DestroyRenderContext(RenderContext& context);
+void MakeRenderContextCurrent(RenderContext& context);
+//The context last made current on this thread by CreateRenderContext() or
+//MakeRenderContextCurrent(), or NULL once it has been destroyed
+RenderContext* CurrentRenderContext();
+void GetRenderSize(const RenderContext& context, int* width, int* height);
+void PresentRenderContext(RenderContext& context);
+//Binds the last presented frame as the read framebuffer/buffer
+void BindPresentedFrame(RenderContext& context);
+
+#endif
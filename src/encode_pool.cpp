@@ -0,0 +1,121 @@
+#include "encode_pool.h"
+#include "frame_alloc.h"
+#include <chrono>
+#include <cstring>
+
+//Longest file name the jobs hold without reallocating
+#define ENCODE_FILE_RESERVE 256
+
+bool EncodePng(const std::string& file, int width, int height, int stride,
+               const unsigned char* pixels, EncodeStats& stats, PngScratch& scratch) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  //Frames come from glReadPixels bottom-up, so walk the rows backwards
+  bool ok = WritePng(file, width, height, pixels + (size_t)stride * (height - 1), -(long)stride,
+                     scratch);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  stats.frames++;
+  stats.bytes += (double)stride * height;
+  stats.seconds += elapsed.count();
+  return(ok);
+}
+
+static void reserveJob(EncodeJob& job, size_t frame_bytes) {
+  job.file.reserve(ENCODE_FILE_RESERVE);
+  ReserveFrameBuffer(job.pixels, frame_bytes);
+}
+
+EncodePool::EncodePool(int n_threads, size_t max_queued, int width, int height, int stride) :
+  worker_jobs(n_threads), worker_scratch(n_threads), queue(max_queued > 0 ? max_queued : 1),
+  head(0), queued(0), done(false), failed(0) {
+  size_t frame_bytes = (size_t)stride * height;
+  for(size_t i = 0; i < queue.size(); i++) {
+    reserveJob(queue[i], frame_bytes);
+  }
+  for(int i = 0; i < n_threads; i++) {
+    reserveJob(worker_jobs[i], frame_bytes);
+    if(width > 0 && height > 0) {
+      worker_scratch[i].reserve(width, height);
+    }
+  }
+  for(int i = 0; i < n_threads; i++) {
+    workers.push_back(std::thread(&EncodePool::work, this, (size_t)i));
+  }
+}
+
+EncodePool::~EncodePool() {
+  finish();
+}
+
+//The slot after the queued jobs is free, and no worker looks at it until
+//`queued` counts it, so the frame is copied in without holding the lock
+void EncodePool::submit(const std::string& file, int width, int height, int stride,
+                        const unsigned char* pixels) {
+  std::unique_lock<std::mutex> guard(lock);
+  has_space.wait(guard, [this] { return queued < queue.size(); });
+  EncodeJob& job = queue[(head + queued) % queue.size()];
+  guard.unlock();
+  if(job.file.capacity() < file.size()) {
+    CountFrameAllocation();
+  }
+  job.file.assign(file);
+  job.width = width;
+  job.height = height;
+  job.stride = stride;
+  size_t size = (size_t)stride * height;
+  std::memcpy(ReserveFrameBuffer(job.pixels, size), pixels, size);
+  guard.lock();
+  queued++;
+  guard.unlock();
+  has_work.notify_one();
+}
+
+int EncodePool::finish() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+  }
+  has_work.notify_all();
+  for(size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+  workers.clear();
+  return(failed);
+}
+
+EncodeStats EncodePool::stats() {
+  std::lock_guard<std::mutex> guard(lock);
+  return(totals);
+}
+
+void EncodePool::work(size_t index) {
+  EncodeJob& job = worker_jobs[index];
+  while(true) {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      has_work.wait(guard, [this] { return done || queued > 0; });
+      if(queued == 0) {
+        return;
+      }
+      //Trade buffers with the queued job, leaving ours in the free slot
+      EncodeJob& next = queue[head];
+      job.file.swap(next.file);
+      job.width = next.width;
+      job.height = next.height;
+      job.stride = next.stride;
+      job.pixels.swap(next.pixels);
+      head = (head + 1) % queue.size();
+      queued--;
+    }
+    has_space.notify_one();
+    //SetPngOptions() is called once on the render thread before any jobs are
+    //submitted, so reading the options here is safe.
+    EncodeStats job_stats;
+    bool ok = EncodePng(job.file, job.width, job.height, job.stride,
+                        job.pixels.data(), job_stats, worker_scratch[index]);
+    std::lock_guard<std::mutex> guard(lock);
+    totals.add(job_stats);
+    if(!ok) {
+      failed++;
+    }
+  }
+}
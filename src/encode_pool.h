@@ -0,0 +1,83 @@
+#ifndef ENCODEPOOLH
+#define ENCODEPOOLH
+
+#include "png_stream.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//One frame waiting to be PNG-compressed and written to disk. Pixels are
+//bottom-up RGB rows, as returned by glReadPixels.
+struct EncodeJob {
+  std::string file;
+  int width;
+  int height;
+  int stride;
+  std::vector<unsigned char> pixels;
+};
+
+//Per-session memory for frames handled on the render thread: the readback
+//buffer, the PNG scratch, and the file name being built. Every render through
+//the session reuses it.
+struct FrameArena {
+  std::vector<unsigned char> pixels;
+  PngScratch png;
+  std::string file;
+};
+
+//Time spent compressing and writing frames (summed over threads)
+struct EncodeStats {
+  EncodeStats() : frames(0), bytes(0), seconds(0) {}
+  void add(const EncodeStats& other) {
+    frames += other.frames;
+    bytes += other.bytes;
+    seconds += other.seconds;
+  }
+  int frames;
+  double bytes;
+  double seconds;
+};
+
+//Compresses and writes one frame with `scratch`, adding the time it took to
+//`stats`
+bool EncodePng(const std::string& file, int width, int height, int stride,
+               const unsigned char* pixels, EncodeStats& stats, PngScratch& scratch);
+
+//Bounded producer/consumer queue feeding a fixed set of worker threads.
+//submit() blocks while `max_queued` frames are already waiting, so memory
+//stays bounded when encoding is slower than rendering. Workers never touch
+//the R API. The queue is a ring of jobs whose pixel buffers, like each
+//worker's own job and PNG scratch, are sized for `width` x `height` frames
+//up front; a worker trades its buffer for the queued one, so buffers just
+//circulate and no frame allocates.
+class EncodePool {
+public:
+  EncodePool(int n_threads, size_t max_queued, int width = 0, int height = 0, int stride = 0);
+  ~EncodePool();
+  //Copies the frame into the next free job. Only one thread may submit.
+  void submit(const std::string& file, int width, int height, int stride,
+              const unsigned char* pixels);
+  //Blocks until every submitted frame is written; returns the number of
+  //frames that failed to write.
+  int finish();
+  EncodeStats stats();
+private:
+  void work(size_t index);
+
+  std::vector<std::thread> workers;
+  std::vector<EncodeJob> worker_jobs;
+  std::vector<PngScratch> worker_scratch;
+  std::vector<EncodeJob> queue;
+  size_t head;
+  size_t queued;
+  std::mutex lock;
+  std::condition_variable has_work;
+  std::condition_variable has_space;
+  bool done;
+  int failed;
+  EncodeStats totals;
+};
+
+#endif
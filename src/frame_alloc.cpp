@@ -0,0 +1,12 @@
+#include "frame_alloc.h"
+#include <atomic>
+
+static std::atomic<size_t> frame_allocations(0);
+
+void CountFrameAllocation() {
+  frame_allocations++;
+}
+
+size_t FrameAllocations() {
+  return(frame_allocations.load());
+}
@@ -0,0 +1,30 @@
+#ifndef FRAMEALLOCH
+#define FRAMEALLOCH
+
+#include <cstddef>
+#include <vector>
+
+//Process-wide count of the heap allocations shadr makes on the frame path:
+//every time a pooled buffer or file name has to grow, zlib asks for memory,
+//or a helper thread (or compression chunk) is created. Buffers are sized up
+//front and then reused, so in a steady frame loop the count stays put;
+//compare it before and after frames to check that. Allocations made inside
+//the C library and drivers aren't seen, e.g. the FILE each PNG frame is
+//written through.
+void CountFrameAllocation();
+size_t FrameAllocations();
+
+//Grows `buffer` to at least `n` elements (counting it if the storage has to
+//be reallocated) and returns its data
+template<typename T>
+T* ReserveFrameBuffer(std::vector<T>& buffer, size_t n) {
+  if(buffer.size() < n) {
+    if(buffer.capacity() < n) {
+      CountFrameAllocation();
+    }
+    buffer.resize(n);
+  }
+  return(buffer.data());
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include "frame_stream.h"
+#include <csignal>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#ifdef _WIN32
+#define SHADR_POPEN_MODE "wb"
+#else
+#define SHADR_POPEN_MODE "w"
+#endif
+
+PipeStream::PipeStream(const std::string& command, double framerate) :
+  f(popen(command.c_str(), SHADR_POPEN_MODE)), framerate(framerate), y4m_header(false) {
+  if(!f) {
+    failed = true;
+    error = "Failed to start `" + command + "`";
+    return;
+  }
+#ifndef _WIN32
+  //If the encoder exits early, writes fail with EPIPE instead of raising
+  //SIGPIPE (R's handler would jump out of the render)
+  old_sigpipe = signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+PipeStream::~PipeStream() {
+  close();
+}
+
+bool PipeStream::write(const unsigned char* pixels, int width, int height, int stride) {
+  if(!f || failed) {
+    return(false);
+  }
+  //Flip to top-down row order on the way out
+  size_t n_bytes = (size_t)width * 3;
+  for(int y = height - 1; y >= 0; y--) {
+    if(fwrite(pixels + (size_t)y * stride, 1, n_bytes, f) != n_bytes) {
+      failed = true;
+      error = "The encoder stopped reading frames";
+      return(false);
+    }
+  }
+  return(true);
+}
+
+bool PipeStream::writeYuv(const unsigned char* planes, int width, int height, bool full_range) {
+  if(!f || failed) {
+    return(false);
+  }
+  bool ok = true;
+  if(!y4m_header) {
+    //Whole frame rates go out as N:1, anything else in thousandths
+    long rate = (long)framerate;
+    std::string fps = (double)rate == framerate ? std::to_string(rate) + ":1" :
+      std::to_string((long)(framerate * 1000 + 0.5)) + ":1000";
+    //C420jpeg: chroma sited between the 2x2 block it averages
+    std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+      " F" + fps + " Ip A1:1 C420jpeg XCOLORRANGE=" + (full_range ? "FULL" : "LIMITED") + "\n";
+    ok = fwrite(header.data(), 1, header.size(), f) == header.size();
+    y4m_header = true;
+  }
+  size_t size = (size_t)width * height * 3 / 2;
+  if(!ok || fwrite("FRAME\n", 1, 6, f) != 6 || fwrite(planes, 1, size, f) != size) {
+    failed = true;
+    error = "The encoder stopped reading frames";
+    return(false);
+  }
+  return(true);
+}
+
+bool PipeStream::close() {
+  if(!f) {
+    return(ok());
+  }
+  int status = pclose(f);
+  f = NULL;
+#ifndef _WIN32
+  signal(SIGPIPE, old_sigpipe);
+#endif
+#ifndef _WIN32
+  if(status != -1 && WIFEXITED(status)) {
+    status = WEXITSTATUS(status);
+  }
+#endif
+  if(status != 0) {
+    error = failed ? error + " (it exited with status " + std::to_string(status) + ")" :
+      "The encoder exited with status " + std::to_string(status);
+    failed = true;
+  }
+  return(ok());
+}
+
+bool CallbackStream::write(const unsigned char* pixels, int width, int height, int stride) {
+  if(failed) {
+    return(false);
+  }
+  size_t n_bytes = (size_t)width * 3;
+  Rcpp::RawVector frame(n_bytes * height);
+  unsigned char* out = RAW(frame);
+  for(int y = 0; y < height; y++) {
+    std::memcpy(out + n_bytes * y, pixels + (size_t)(height - 1 - y) * stride, n_bytes);
+  }
+  frame.attr("dim") = Rcpp::IntegerVector::create(3, width, height);
+  return(call(frame));
+}
+
+bool CallbackStream::writeYuv(const unsigned char* planes, int width, int height,
+                              bool /*full_range*/) {
+  if(failed) {
+    return(false);
+  }
+  size_t size = (size_t)width * height * 3 / 2;
+  Rcpp::RawVector frame(size);
+  std::memcpy(RAW(frame), planes, size);
+  return(call(frame));
+}
+
+bool CallbackStream::call(SEXP frame) {
+  int number = counter < (int)numbers.size() ? numbers[counter] : counter + 1;
+  counter++;
+  //Errors are held until the render has unwound (frames still in the
+  //readback ring are dropped) and then raised from R by close(). R's own
+  //unwinding (a longjmp out of the callback) and user interrupts are kept
+  //as they are and rethrown, so R sees the original condition.
+  try {
+    callback(frame, number);
+  } catch(Rcpp::LongjumpException&) {
+    failed = true;
+    pending = std::current_exception();
+  } catch(Rcpp::internal::InterruptedException&) {
+    failed = true;
+    pending = std::current_exception();
+  } catch(std::exception& e) {
+    failed = true;
+    error = "The frame callback failed on frame " + std::to_string(number) + ": " + e.what();
+  } catch(...) {
+    failed = true;
+    error = "The frame callback failed on frame " + std::to_string(number) +
+      " with an unknown error";
+  }
+  return(ok());
+}
+
+ArrayStream::ArrayStream(int width, int height, int frames, bool raw) :
+  width(width), height(height), frames(frames), raw(raw), counter(0) {
+  //Every rendered frame is overwritten in full, so skip zeroing here
+  R_xlen_t size = (R_xlen_t)width * height * 3 * frames;
+  Rcpp::IntegerVector dim = Rcpp::IntegerVector::create(height, width, 3, frames);
+  if(raw) {
+    raw_array = Rcpp::RawVector(Rcpp::no_init(size));
+    raw_array.attr("dim") = dim;
+  } else {
+    numeric_array = Rcpp::NumericVector(Rcpp::no_init(size));
+    numeric_array.attr("dim") = dim;
+    for(int i = 0; i < 256; i++) {
+      scale[i] = i / 255.0;
+    }
+  }
+}
+
+bool ArrayStream::write(const unsigned char* pixels, int width, int height, int stride) {
+  if(failed || counter >= frames) {
+    return(false);
+  }
+  if(width != this->width || height != this->height) {
+    failed = true;
+    error = "Frame size changed while rendering into an array";
+    return(false);
+  }
+  size_t offset = (size_t)width * height * 3 * counter;
+  if(raw) {
+    CopyFrameToR(pixels, width, height, stride, raw_array.begin() + offset,
+              [](unsigned char v) { return(v); });
+  } else {
+    const double* to_unit = scale;
+    CopyFrameToR(pixels, width, height, stride, numeric_array.begin() + offset,
+              [to_unit](unsigned char v) { return(to_unit[v]); });
+  }
+  counter++;
+  return(true);
+}
+
+bool ArrayStream::writeYuv(const unsigned char* /*planes*/, int /*width*/, int /*height*/,
+                           bool /*full_range*/) {
+  failed = true;
+  error = "Arrays can only hold RGB frames";
+  return(false);
+}
+
+bool ArrayStream::close() {
+  //Zero whatever an early stop (e.g. closing the window) left unrendered
+  size_t done = (size_t)width * height * 3 * counter;
+  size_t size = (size_t)width * height * 3 * frames;
+  if(raw) {
+    std::fill(raw_array.begin() + done, raw_array.begin() + size, 0);
+  } else {
+    std::fill(numeric_array.begin() + done, numeric_array.begin() + size, 0.0);
+  }
+  return(ok());
+}
+
+FrameStream* NewFrameStream(const std::string& command, SEXP callback, double framerate,
+                            int array_type, int width, int height, int frames,
+                            const std::vector<int>& numbers) {
+  if(array_type > 0) {
+    return(new ArrayStream(width, height, frames, array_type == 2));
+  }
+  if(Rf_isFunction(callback)) {
+    return(new CallbackStream(callback, numbers));
+  }
+  if(!command.empty()) {
+    return(new PipeStream(command, framerate));
+  }
+  return(NULL);
+}
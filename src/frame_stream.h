@@ -0,0 +1,140 @@
+#ifndef FRAMESTREAMH
+#define FRAMESTREAMH
+
+#include <Rcpp.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+//Scatters a bottom-up RGB frame (rows `stride` elements apart) into R's
+//column-major height x width x 3 layout, flipping it on the way. Columns are
+//walked in blocks so the source row segments and the output column runs
+//being written both stay in cache.
+template<typename In, typename Out, typename Convert>
+void CopyFrameToR(const In* pixels, int width, int height, size_t stride, Out* out,
+                  Convert convert) {
+  size_t plane = (size_t)width * height;
+  const int block = 32;
+  for(int x0 = 0; x0 < width; x0 += block) {
+    int x1 = std::min(width, x0 + block);
+    for(int y = 0; y < height; y++) {
+      const In* row = pixels + (size_t)(height - 1 - y) * stride;
+      for(int x = x0; x < x1; x++) {
+        size_t i = (size_t)x * height + y;
+        out[i] = convert(row[3 * x]);
+        out[i + plane] = convert(row[3 * x + 1]);
+        out[i + 2 * plane] = convert(row[3 * x + 2]);
+      }
+    }
+  }
+}
+
+//Takes read-back frames in render order instead of writing an image file per
+//frame. RGB frames arrive as OpenGL leaves them: bottom-up 8-bit rows,
+//`stride` bytes apart. YUV frames come from the GPU conversion pass as packed
+//top-down Y, U and V planes (4:2:0, BT.709). Streams are written to on the
+//render thread only.
+class FrameStream {
+public:
+  FrameStream() : failed(false) {}
+  virtual ~FrameStream() {}
+  virtual bool write(const unsigned char* pixels, int width, int height, int stride) = 0;
+  virtual bool writeYuv(const unsigned char* planes, int width, int height, bool full_range) = 0;
+  //Fails if any frame failed to write or the consumer reported an error
+  virtual bool close() = 0;
+  //What the render returns to R, if anything
+  virtual SEXP result() { return(R_NilValue); }
+  //Whether writing a frame runs R code, which can render with (or collect and
+  //close) another session and so leave a different GL context current
+  virtual bool runsR() const { return(false); }
+  bool ok() const { return !failed; }
+  std::string error;
+protected:
+  bool failed;
+};
+
+//Writes frames into the stdin of a shell command: RGB frames packed top-down
+//(ffmpeg's `-f rawvideo -pix_fmt rgb24`), YUV frames as a YUV4MPEG2 stream
+//at `framerate` (`-f yuv4mpegpipe`). A full pipe blocks the render until the
+//encoder catches up.
+class PipeStream : public FrameStream {
+public:
+  PipeStream(const std::string& command, double framerate = 30);
+  ~PipeStream();
+  bool write(const unsigned char* pixels, int width, int height, int stride);
+  bool writeYuv(const unsigned char* planes, int width, int height, bool full_range);
+  //Waits for the command to exit
+  bool close();
+private:
+  FILE* f;
+  double framerate;
+  bool y4m_header;
+#ifndef _WIN32
+  void (*old_sigpipe)(int);
+#endif
+};
+
+//Calls an R function with each frame as a raw vector and its frame number
+//(1-based, or numbers[i] for the i-th frame when `numbers` is given): packed
+//top-down RGB bytes with dim c(3, width, height), or the Y, U and V planes
+//back to back. The first error stops the stream and is kept in `error`.
+class CallbackStream : public FrameStream {
+public:
+  CallbackStream(SEXP callback, const std::vector<int>& numbers = std::vector<int>()) :
+    callback(callback), numbers(numbers), counter(0) {}
+  bool write(const unsigned char* pixels, int width, int height, int stride);
+  bool writeYuv(const unsigned char* planes, int width, int height, bool full_range);
+  bool runsR() const { return(true); }
+  //Rethrows an R longjump or interrupt that stopped the callback
+  bool close() {
+    if(pending) {
+      std::exception_ptr rethrow = pending;
+      pending = std::exception_ptr();
+      std::rethrow_exception(rethrow);
+    }
+    return ok();
+  }
+private:
+  Rcpp::Function callback;
+  std::vector<int> numbers;
+  int counter;
+  std::exception_ptr pending;
+
+  bool call(SEXP frame);
+};
+
+//Copies each RGB frame straight into a preallocated R array, height x width
+//x 3 x frames in R's column-major order with the top row first: doubles in
+//[0, 1] (as rayimage and png::readPNG use) or raw bytes. Frames that were
+//never rendered are left as zeros.
+class ArrayStream : public FrameStream {
+public:
+  ArrayStream(int width, int height, int frames, bool raw);
+  bool write(const unsigned char* pixels, int width, int height, int stride);
+  bool writeYuv(const unsigned char* planes, int width, int height, bool full_range);
+  bool close();
+  SEXP result() { return(raw ? (SEXP)raw_array : (SEXP)numeric_array); }
+private:
+  Rcpp::RawVector raw_array;
+  Rcpp::NumericVector numeric_array;
+  int width;
+  int height;
+  int frames;
+  bool raw;
+  int counter;
+  //Byte to [0, 1] lookup for numeric arrays
+  double scale[256];
+};
+
+//The stream an R call asked for: an array of `frames` width x height frames
+//if `array_type` is 1 (numeric) or 2 (raw), otherwise `callback` if it is a
+//function (called with `numbers` as its frame numbers, if given), otherwise
+//a pipe into `command` if that is not empty, otherwise none (NULL)
+FrameStream* NewFrameStream(const std::string& command, SEXP callback, double framerate,
+                            int array_type, int width, int height, int frames,
+                            const std::vector<int>& numbers = std::vector<int>());
+
+#endif
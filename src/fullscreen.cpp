@@ -0,0 +1,134 @@
+#include "fullscreen.h"
+#include "glm/glm.hpp"
+#include "glm/gtx/transform.hpp" 
+
+static size_t gl_calls = 0;
+
+//Counting stand-in for one GLEW function pointer. `Id` keeps the saved
+//pointers of entry points with the same signature apart.
+template<int Id, typename Function>
+struct CountedEntry;
+
+template<int Id, typename R, typename... Args>
+struct CountedEntry<Id, R (GLAPIENTRY*)(Args...)> {
+  typedef R (GLAPIENTRY* Function)(Args...);
+  static Function& original() {
+    static Function function = NULL;
+    return(function);
+  }
+  static R GLAPIENTRY call(Args... args) {
+    gl_calls++;
+    return(original()(args...));
+  }
+  static void install(Function& entry) {
+    if(entry != NULL && entry != &call) {
+      original() = entry;
+      entry = &call;
+    }
+  }
+};
+
+//One per line: the line number is the entry's Id
+#define COUNT_GLEW_ENTRY(name) CountedEntry<__LINE__, decltype(__glew##name)>::install(__glew##name)
+
+size_t GLCalls() {
+  return(gl_calls);
+}
+
+void InstallGLCallCounters() {
+  COUNT_GLEW_ENTRY(Uniform1f);
+  COUNT_GLEW_ENTRY(Uniform1i);
+  COUNT_GLEW_ENTRY(Uniform2f);
+  COUNT_GLEW_ENTRY(Uniform2i);
+  COUNT_GLEW_ENTRY(UniformMatrix4fv);
+  COUNT_GLEW_ENTRY(UniformBlockBinding);
+  COUNT_GLEW_ENTRY(GetUniformLocation);
+  COUNT_GLEW_ENTRY(UseProgram);
+  COUNT_GLEW_ENTRY(BindVertexArray);
+  COUNT_GLEW_ENTRY(VertexAttribPointer);
+  COUNT_GLEW_ENTRY(EnableVertexAttribArray);
+  COUNT_GLEW_ENTRY(BindBuffer);
+  COUNT_GLEW_ENTRY(BindBufferBase);
+  COUNT_GLEW_ENTRY(BufferData);
+  COUNT_GLEW_ENTRY(BindFramebuffer);
+  COUNT_GLEW_ENTRY(DrawBuffers);
+  COUNT_GLEW_ENTRY(ActiveTexture);
+}
+
+//The same orthographic camera the quad was always drawn with
+static glm::mat4 fullscreenMVP() {
+  glm::mat4 Projection = glm::ortho(-1.0f, 1.0f,-1.0f,1.0f, -0.5f, 1000.0f);
+  glm::mat4 View       = glm::lookAt(
+    glm::vec3(0,0,-1), // Camera Location
+    glm::vec3(0,0,0), // Looks at the origin
+    glm::vec3(0,1,0)  // Camera up is +Y
+  );
+  return(Projection * View * glm::mat4(1.0f));
+}
+
+void CreateFullscreenTriangle(FullscreenTriangle& triangle) {
+  //Vertex i is where ((i << 1) & 2, i & 2) * 2 - 1 puts it, so shaders that
+  //build it from gl_VertexID and ones that read the attributes agree. UVs are
+  //the quad's: u runs up the screen and v across it.
+  static const GLfloat g_vertex_buffer_data[] = {
+    -1.0f,-1.0f, 0.0f,
+    3.0f,-1.0f, 0.0f,
+    -1.0f, 3.0f, 0.0f
+  };
+
+  static const GLfloat g_uv_buffer_data[] = {
+    0.0f, 0.0f,
+    0.0f, 2.0f,
+    2.0f, 0.0f
+  };
+
+  glGenVertexArrays(1, &triangle.vertex_array);
+  glBindVertexArray(triangle.vertex_array);
+
+  glGenBuffers(1, &triangle.vertexbuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, triangle.vertexbuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+  glGenBuffers(1, &triangle.uvbuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, triangle.uvbuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(g_uv_buffer_data), g_uv_buffer_data, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glm::mat4 MVP = fullscreenMVP();
+  glGenBuffers(1, &triangle.transform);
+  glBindBuffer(GL_UNIFORM_BUFFER, triangle.transform);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(MVP), &MVP[0][0], GL_STATIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, SHADR_TRANSFORM_BINDING, triangle.transform);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void DestroyFullscreenTriangle(FullscreenTriangle& triangle) {
+  glDeleteBuffers(1, &triangle.vertexbuffer);
+  glDeleteBuffers(1, &triangle.uvbuffer);
+  glDeleteBuffers(1, &triangle.transform);
+  glDeleteVertexArrays(1, &triangle.vertex_array);
+  triangle.vertex_array = 0;
+  triangle.vertexbuffer = 0;
+  triangle.uvbuffer = 0;
+  triangle.transform = 0;
+}
+
+void SetFullscreenUniforms(GLuint program) {
+  GLuint block = glGetUniformBlockIndex(program, SHADR_TRANSFORM_BLOCK);
+  if(block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, block, SHADR_TRANSFORM_BINDING);
+  }
+  GLint MatrixID = glGetUniformLocation(program, "MVP");
+  if(MatrixID >= 0) {
+    glm::mat4 MVP = fullscreenMVP();
+    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
+  }
+}
+
+void DrawFullscreenTriangle() {
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
@@ -0,0 +1,49 @@
+#ifndef FULLSCREENH
+#define FULLSCREENH
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+#include <cstddef>
+
+//Uniform block the constant transform lives in, and the binding point its
+//buffer stays bound to
+#define SHADR_TRANSFORM_BLOCK "ShadrTransform"
+#define SHADR_TRANSFORM_BINDING 0
+
+//Everything a frame is drawn with, recorded once: a vertex array holding one
+//triangle that covers the viewport, and a uniform buffer with the constant
+//MVP matrix. Built-in shaders place the triangle from gl_VertexID and read
+//MVP from the `ShadrTransform` block, so they use no attributes at all; the
+//vertex array still feeds position (location 0) and UV (location 1) for user
+//vertex shaders written against the old quad.
+struct FullscreenTriangle {
+  GLuint vertex_array;
+  GLuint vertexbuffer;
+  GLuint uvbuffer;
+  GLuint transform;
+};
+
+//Leaves the vertex array bound
+void CreateFullscreenTriangle(FullscreenTriangle& triangle);
+void DestroyFullscreenTriangle(FullscreenTriangle& triangle);
+//Points the program in use's transform block at the shared buffer and sets a
+//plain `uniform mat4 MVP`, if it declares one instead. Both stick to the
+//program, so this is done once per render, not per frame.
+void SetFullscreenUniforms(GLuint program);
+//One draw call
+void DrawFullscreenTriangle();
+
+//CPU-side count of the calls made through GLEW's dispatch to the entry points
+//that set per-draw state: uniforms (and their lookup), programs, vertex
+//arrays and attributes, buffers, framebuffers, and texture units. Render
+//loops compare it before and after drawing a frame to check that only what
+//changed is set. GL 1.1 entry points (glClear, glViewport, glDrawArrays)
+//aren't dispatched through GLEW and aren't counted.
+size_t GLCalls();
+//Swaps counting stand-ins into GLEW's function pointers; called again after
+//every glewInit(), which overwrites them
+void InstallGLCallCounters();
+
+#endif
@@ -5,204 +5,55 @@ using namespace Rcpp;
 #include <GL/glew.h>
 //GLWF3 Installed with cmake, make install 
 #include <GLFW/glfw3.h>
-#include "glm/glm.hpp"
-#include "glm/gtx/transform.hpp" 
-#include "controls.h"
-#include "loadshaders.h"
-#include "save_image.h"
+#include "render_session.h"
+#include <memory>
 #include <string>
 
 // [[Rcpp::export]]
-int generate_video_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader,
+SEXP generate_video_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader,
                      int width, int height, int type,  bool verbose,
-                     float step, int frames, CharacterVector filename) {
-  glfwInitHint(GLFW_COCOA_CHDIR_RESOURCES, GLFW_FALSE);
-  if(!glfwInit()){
-    return(-1);
-  }
+                     double start, double step, int frames, NumericVector times,
+                     IntegerVector numbers,
+                     CharacterVector filename,
+                     int backend, int readback_buffers, int encode_threads,
+                     int png_level, int png_filter, int compress_threads,
+                     CharacterVector pipe_command, SEXP callback, double framerate,
+                     int yuv_range, int array_type, bool offline) {
   std::string filestring = Rcpp::as<std::string>(filename);
-  int nx = width;
-  int ny = height;
-  glfwWindowHint(GLFW_SAMPLES, 4); // 4x antialiasing
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // We want OpenGL 3.3
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // We don't want the old OpenGL
-  GLFWwindow* window; // (In the accompanying source code, this variable is global for simplicity)
-  window = glfwCreateWindow( nx, ny, "shadr", NULL, NULL);
-  if( window == NULL ){
-    Rcpp::Rcout << "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n" ;
-    glfwTerminate();
-    return(-1);
+  FrameClock clock(start, step);
+  clock.times.assign(times.begin(), times.end());
+  if(!clock.times.empty()) {
+    frames = (int)clock.times.size();
   }
-  glfwMakeContextCurrent(window); // Initialize GLEW
-  glewExperimental=true; // Needed in core profile
-  if (glewInit() != GLEW_OK) {
-    Rcpp::Rcout << "Failed to initialize GLEW\n";
-    return(-1);
+  if(numbers.size() > 0) {
+    if((int)numbers.size() != frames) {
+      Rcpp::stop("Expected one frame number per frame.");
+    }
+    clock.numbers.assign(numbers.begin(), numbers.end());
   }
-  glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
-  // Hide the mouse and enable unlimited movement
-  // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-  glfwPollEvents();
-  // glfwSetCursorPos(window, nx/2, ny/2);
-  glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
-
-  GLuint VertexArrayID;
-  glGenVertexArrays(1, &VertexArrayID);
-  glBindVertexArray(VertexArrayID);
-
-  // Create and compile our GLSL program from the shaders
-  GLuint programID = LoadShaders( vertex_shader, fragment_shader,verbose);
-
-  GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-  glm::mat4 Projection = glm::ortho(-1.0f, 1.0f,-1.0f,1.0f, -0.5f, 1000.0f);
-
-  // Camera matrix
-  glm::mat4 View       = glm::lookAt(
-    glm::vec3(0,0,-1), // Camera Location
-    glm::vec3(0,0,0), // Looks at the origin
-    glm::vec3(0,1,0)  // Camera up is +Y
-  );
-  glm::mat4 Model      = glm::mat4(1.0f);
-  glm::mat4 MVP        = Projection * View * Model;
-
-  static const GLfloat g_vertex_buffer_data[] = {
-    -1.0f,-1.0f, 0.0f,
-    1.0f,1.0f, 0.0f,
-    -1.0f, 1.0f, 0.0f,
-    -1.0f,-1.0f, 0.0f,
-    1.0f,-1.0f, 0.0f,
-    1.0f,1.0f, 0.0f
-  };
-
-  static const GLfloat g_uv_buffer_data[] = {
-    0.0f, 0.0f,
-    1.0f, 1.0f,
-    1.0f, 0.0f,
-    0.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f
-  };
-
-  GLuint uTime;
-  if(type == 1) {
-    uTime = glGetUniformLocation(programID, "u_time");
-  } else {
-    uTime = glGetUniformLocation(programID, "iTime");
+  RenderSession session;
+  if(!session.start(width, height, backend, verbose)) {
+    return(wrap(-1));
   }
-  float t = 0;
-
-  GLuint screenResolution;
-  if(type == 1) {
-    screenResolution = glGetUniformLocation(programID, "u_resolution");
-  } else {
-    screenResolution = glGetUniformLocation(programID, "iResolution");
+  std::unique_ptr<FrameStream> stream(NewFrameStream(Rcpp::as<std::string>(pipe_command),
+                                                     callback, framerate, array_type,
+                                                     width, height, frames,
+                                                     clock.numbers));
+  int rendered = session.renderFrames(vertex_shader, fragment_shader, type, clock, frames,
+                                      filestring, readback_buffers, encode_threads, png_level,
+                                      png_filter, compress_threads, stream.get(), yuv_range,
+                                      NULL, offline);
+  session.close();
+  if(rendered == 0) {
+    Rcpp::stop("Failed to build the shader program.");
   }
-
-  GLuint mousePos;
-  mousePos = glGetUniformLocation(programID, "u_mouse");
-
-  GLuint vertexbuffer;
-  glGenBuffers(1, &vertexbuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
-
-  GLuint uvbuffer;
-  glGenBuffers(1, &uvbuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(g_uv_buffer_data), g_uv_buffer_data, GL_STATIC_DRAW);
-
-  bool pause = false;
-  double xpos, ypos;
-  double debounce_time = 0.0;
-  std::string fileext = ".png";
-  
-  int counter = 0;
-  do{
-    // Clear the screen
-    if(glfwGetTime() - debounce_time > 0.1) {
-      if(!pause) {
-        t += step;
-      }
+  if(stream) {
+    if(!stream->close()) {
+      Rcpp::stop(stream->error);
     }
-    glfwGetCursorPos(window, &xpos, &ypos);
-    glfwPollEvents();
-
-    if(glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-      pause = !pause;
-      debounce_time = glfwGetTime();
+    if(stream->result() != R_NilValue) {
+      return(stream->result());
     }
-    glfwPollEvents();
-
-
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Use our shader
-    glUseProgram(programID);
-    glUniform1f(uTime, t);
-
-    int width2, height2;
-    glfwGetFramebufferSize(window, &width2, &height2);
-    glViewport(0, 0, width2, height2);
-
-    glUniform2f(screenResolution, width2, height2);
-    glUniform2f(mousePos, xpos, ypos);
-
-    // Send our transformation to the currently bound shader,
-    // in the "MVP" uniform
-    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glVertexAttribPointer(
-      0,                  // attribute. No particular reason for 0, but must match the layout in the shader.
-      3,                  // size
-      GL_FLOAT,           // type
-      GL_FALSE,           // normalized?
-      0,                  // stride
-      (void*)0            // array buffer offset
-    );
-
-    // 2nd attribute buffer : UVs
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glVertexAttribPointer(
-      1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-      2,                                // size : U+V => 2
-      GL_FLOAT,                         // type
-      GL_FALSE,                         // normalized?
-      0,                                // stride
-      (void*)0                          // array buffer offset
-    );
-
-    // Draw the triangle !
-    glDrawArrays(GL_TRIANGLES, 0, 2*3); 
-
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-
-    // Swap buffers
-    glfwSwapBuffers(window);
-    glfwPollEvents();
-    counter++;
-    std::string countstr = std::to_string(counter);
-    saveImage((filestring + countstr + fileext).c_str(), window);
-    glfwPollEvents();
-    
-  } while((!glfwWindowShouldClose(window) &&
-            glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS) &&
-            counter < frames);
-  glDeleteBuffers(1, &vertexbuffer);
-  glDeleteBuffers(1, &uvbuffer);
-  glDeleteProgram(programID);
-  glDeleteVertexArrays(1, &VertexArrayID);
-  glfwPollEvents();
-  
-  glfwDestroyWindow(window);
-  glfwPollEvents();
-  glfwTerminate();
-  return(1);
+  }
+  return(wrap(1));
 }
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include "hdr_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+bool WriteHdr(const std::string& file, int width, int height, const float* pixels) {
+  stbi_flip_vertically_on_write(1);
+  int ok = stbi_write_hdr(file.c_str(), width, height, 3, pixels);
+  stbi_flip_vertically_on_write(0);
+  return(ok != 0);
+}
@@ -0,0 +1,10 @@
+#ifndef HDRIMAGEH
+#define HDRIMAGEH
+
+#include <string>
+
+//Writes float RGB pixels (bottom-up, as read back from GL) as a Radiance
+//.hdr image. Values are stored unclamped, to about 1% precision.
+bool WriteHdr(const std::string& file, int width, int height, const float* pixels);
+
+#endif
@@ -0,0 +1,78 @@
+#include "image_texels.h"
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHADR_X86_SIMD
+#include <immintrin.h>
+#endif
+
+//Interleaves `n` values from each channel into `out`
+static void interleaveSpan(const double* r, const double* g, const double* b,
+                           size_t start, size_t n, float* out) {
+  for(size_t j = start; j < n; j++) {
+    out[3 * j]     = (float)r[j];
+    out[3 * j + 1] = (float)g[j];
+    out[3 * j + 2] = (float)b[j];
+  }
+}
+
+void ImageToTexelsScalar(const double* image, int height, int width, float* texels) {
+  size_t plane = (size_t)height * width;
+  for(int i = 0; i < width; i++) {
+    const double* r = image + (size_t)(width - 1 - i) * height;
+    interleaveSpan(r, r + plane, r + 2 * plane, 0, height, texels + (size_t)i * height * 3);
+  }
+}
+
+#ifdef SHADR_X86_SIMD
+__attribute__((target("sse2")))
+static inline __m128 load4Sse2(const double* p) {
+  return(_mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(p)), _mm_cvtpd_ps(_mm_loadu_pd(p + 2))));
+}
+
+//Four pixels at a time: three planar loads become the three vectors
+//r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+__attribute__((target("sse2")))
+static void imageToTexelsSse2(const double* image, int height, int width, float* texels) {
+  size_t plane = (size_t)height * width;
+  size_t end = (size_t)height & ~(size_t)3;
+  for(int i = 0; i < width; i++) {
+    const double* r = image + (size_t)(width - 1 - i) * height;
+    const double* g = r + plane;
+    const double* b = g + plane;
+    float* out = texels + (size_t)i * height * 3;
+    for(size_t j = 0; j < end; j += 4) {
+      __m128 vr = load4Sse2(r + j);
+      __m128 vg = load4Sse2(g + j);
+      __m128 vb = load4Sse2(b + j);
+      __m128 rg_lo = _mm_unpacklo_ps(vr, vg);
+      __m128 rg_hi = _mm_unpackhi_ps(vr, vg);
+      __m128 br_1 = _mm_shuffle_ps(vb, vr, _MM_SHUFFLE(1, 1, 0, 0));
+      __m128 gb_1 = _mm_shuffle_ps(vg, vb, _MM_SHUFFLE(1, 1, 1, 1));
+      __m128 br_3 = _mm_shuffle_ps(vb, vr, _MM_SHUFFLE(3, 3, 2, 2));
+      __m128 gb_3 = _mm_shuffle_ps(vg, vb, _MM_SHUFFLE(3, 3, 3, 3));
+      _mm_storeu_ps(out + 3 * j,     _mm_shuffle_ps(rg_lo, br_1, _MM_SHUFFLE(2, 0, 1, 0)));
+      _mm_storeu_ps(out + 3 * j + 4, _mm_shuffle_ps(gb_1, rg_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+      _mm_storeu_ps(out + 3 * j + 8, _mm_shuffle_ps(br_3, gb_3, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+    interleaveSpan(r, g, b, end, height, out);
+  }
+}
+#endif
+
+typedef void (*TexelFunction)(const double*, int, int, float*);
+
+static TexelFunction selectTexels() {
+#ifdef SHADR_X86_SIMD
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse2")) {
+    return(imageToTexelsSse2);
+  }
+#endif
+  return(ImageToTexelsScalar);
+}
+
+void ImageToTexels(const double* image, int height, int width, float* texels) {
+  static const TexelFunction image_to_texels = selectTexels();
+  image_to_texels(image, height, width, texels);
+}
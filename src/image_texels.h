@@ -0,0 +1,14 @@
+#ifndef IMAGETEXELSH
+#define IMAGETEXELSH
+
+//Converts channels 1-3 of an R height x width x channels double array
+//(column-major) into interleaved float RGB texels for glTexImage2D. Texel row
+//i is image column width - 1 - i, so the texture is `height` texels wide and
+//`width` tall, and the row is one contiguous run of each channel. SSE2 is
+//used when the CPU has it, with a scalar fallback.
+void ImageToTexels(const double* image, int height, int width, float* texels);
+
+//The portable version, always available
+void ImageToTexelsScalar(const double* image, int height, int width, float* texels);
+
+#endif
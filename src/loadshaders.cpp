@@ -1,3 +1,8 @@
+#ifdef _WIN32
+//Before R's headers, whose macros clash with windows.h
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 #include <Rcpp.h>
 
 //glew Installed make install 
@@ -5,19 +10,229 @@
 //GLWF3 Installed with cmake, make install 
 #include <GLFW/glfw3.h>
 
+#include "loadshaders.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+//Directory for linked program binaries; empty disables the on-disk cache
+static std::string binary_cache_dir;
+
+void SetProgramBinaryCacheDir(const std::string& dir) {
+  binary_cache_dir = dir;
+}
+
+const std::string& GetProgramBinaryCacheDir() {
+  return(binary_cache_dir);
+}
+
+//64-bit FNV-1a
+static unsigned long long hashSource(const std::string& source) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < source.size(); i++) {
+    hash ^= (unsigned char)source[i];
+    hash *= 1099511628211ULL;
+  }
+  return(hash);
+}
+
+
+//Splices `defines` in after the #version directive (which must stay first)
+//Defines go after the #version line and any #extension directives, which
+//GLSL requires to come before everything else
+static std::string addDefines(const std::string& code, const std::string& defines) {
+  if(defines.empty()) {
+    return(code);
+  }
+  size_t version = code.find("#version");
+  if(version == std::string::npos) {
+    return(defines + code);
+  }
+  size_t insert_at = code.find('\n', version);
+  if(insert_at == std::string::npos) {
+    return(code + "\n" + defines);
+  }
+  insert_at++;
+  for(size_t line = insert_at; line < code.size(); ) {
+    size_t line_end = code.find('\n', line);
+    line_end = line_end == std::string::npos ? code.size() : line_end + 1;
+    size_t text = code.find_first_not_of(" \t\r", line);
+    if(text < line_end && code.compare(text, 10, "#extension") == 0) {
+      insert_at = line_end;
+    }
+    line = line_end;
+  }
+  if(insert_at == code.size() && code[code.size() - 1] != '\n') {
+    return(code + "\n" + defines);
+  }
+  return(code.substr(0, insert_at) + defines + code.substr(insert_at));
+}
+
+//Drivers may support GL_ARB_get_program_binary and still expose zero formats
+static bool programBinarySupported() {
+  GLint n_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  glGetError(); //GL_INVALID_ENUM on drivers without the extension
+  return(n_formats > 0);
+}
+
+//Binaries are only valid for the driver that produced them, so the vendor,
+//renderer and version strings are part of the key. The full key is stored in
+//the file as well, so a hash collision just falls back to compiling.
+static std::string programBinaryKey(const std::string& vertex_code,
+                                    const std::string& fragment_code) {
+  std::string key = vertex_code;
+  key += '\0';
+  key += fragment_code;
+  key += '\0';
+  key += (const char*)glGetString(GL_VENDOR);
+  key += '\0';
+  key += (const char*)glGetString(GL_RENDERER);
+  key += '\0';
+  key += (const char*)glGetString(GL_VERSION);
+  return(key);
+}
+
+static std::string programBinaryFile(const std::string& key) {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", hashSource(key));
+  return(binary_cache_dir + "/" + hex + ".glbin");
+}
+
+static const char program_binary_magic[8] = {'S','H','A','D','R','P','B','1'};
+
+//Returns 0 if there is no usable binary (missing, stale, or rejected by the driver)
+static GLuint loadProgramBinary(const std::string& file, const std::string& key, bool verbose) {
+  std::ifstream in(file.c_str(), std::ios::binary);
+  if(!in) {
+    return(0);
+  }
+  char magic[8];
+  unsigned long long key_size = 0, binary_size = 0;
+  GLenum format = 0;
+  in.read(magic, sizeof(magic));
+  in.read((char*)&key_size, sizeof(key_size));
+  if(!in || std::string(magic, sizeof(magic)) != std::string(program_binary_magic, sizeof(magic)) ||
+     key_size != key.size()) {
+    return(0);
+  }
+  std::string stored_key(key_size, '\0');
+  in.read(&stored_key[0], key_size);
+  in.read((char*)&format, sizeof(format));
+  in.read((char*)&binary_size, sizeof(binary_size));
+  if(!in || stored_key != key || binary_size == 0) {
+    return(0);
+  }
+  std::vector<char> binary(binary_size);
+  in.read(binary.data(), binary_size);
+  if(!in) {
+    return(0);
+  }
+  GLuint ProgramID = glCreateProgram();
+  glProgramBinary(ProgramID, format, binary.data(), (GLsizei)binary_size);
+  GLint Result = GL_FALSE;
+  glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+  if(Result != GL_TRUE) {
+    //Usually a driver update; recompile and overwrite the stale binary
+    glDeleteProgram(ProgramID);
+    std::remove(file.c_str());
+    return(0);
+  }
+  if(verbose) {
+    Rcpp::Rcout << "Loaded program binary from cache\n";
+  }
+  return(ProgramID);
+}
+
+//A temporary name next to `file` that no other process or thread will pick:
+//the pid, a per-process counter and a random suffix
+static std::string uniqueTempFile(const std::string& file) {
+  static std::atomic<unsigned int> counter(0);
+  std::random_device random;
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".%ld.%u.%08x.tmp", (long)getpid(),
+           counter.fetch_add(1), (unsigned int)random());
+  return(file + suffix);
+}
+
+//Moves `from` over `to` in one step, so readers see either the old file or the
+//new one and never a missing or partial one
+static bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+  return(MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+  return(std::rename(from.c_str(), to.c_str()) == 0);
+#endif
+}
+
+//Written to a temporary file of its own and renamed over the target, so
+//concurrent R sessions (and movie workers) linking the same shader never see
+//a partial binary. Failing to publish it just leaves a cache miss.
+static void saveProgramBinary(GLuint ProgramID, const std::string& file, const std::string& key) {
+  GLint binary_length = 0;
+  glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+  if(binary_length <= 0) {
+    return;
+  }
+  std::vector<char> binary(binary_length);
+  GLenum format = 0;
+  glGetProgramBinary(ProgramID, binary_length, NULL, &format, binary.data());
+  std::string tmp_file = uniqueTempFile(file);
+  {
+    std::ofstream out(tmp_file.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out) {
+      return;
+    }
+    unsigned long long key_size = key.size(), binary_size = binary.size();
+    out.write(program_binary_magic, sizeof(program_binary_magic));
+    out.write((const char*)&key_size, sizeof(key_size));
+    out.write(key.data(), key_size);
+    out.write((const char*)&format, sizeof(format));
+    out.write((const char*)&binary_size, sizeof(binary_size));
+    out.write(binary.data(), binary_size);
+    out.close();
+    if(!out) {
+      std::remove(tmp_file.c_str());
+      return;
+    }
+  }
+  if(!replaceFile(tmp_file, file)) {
+    std::remove(tmp_file.c_str());
+  }
+}
+
 GLuint LoadShaders(const Rcpp::CharacterVector vertex_shader, 
                    const Rcpp::CharacterVector fragment_shader,
-                   bool verbose){
-  
-  // Create the shaders
-  GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-  GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+                   bool verbose, const std::string& defines){
   
   // Read the Vertex Shader code from the file
-  std::string VertexShaderCode = Rcpp::as<std::string>(vertex_shader); 
+  std::string VertexShaderCode = addDefines(Rcpp::as<std::string>(vertex_shader), defines);
   
   // Read the Fragment Shader code from the file
-  std::string FragmentShaderCode = Rcpp::as<std::string>(fragment_shader);
+  std::string FragmentShaderCode = addDefines(Rcpp::as<std::string>(fragment_shader), defines);
+  
+  // Reuse a binary linked by an earlier R session, if there is one
+  std::string BinaryKey, BinaryFile;
+  if(!binary_cache_dir.empty() && programBinarySupported()) {
+    BinaryKey = programBinaryKey(VertexShaderCode, FragmentShaderCode);
+    BinaryFile = programBinaryFile(BinaryKey);
+    GLuint CachedProgramID = loadProgramBinary(BinaryFile, BinaryKey, verbose);
+    if(CachedProgramID) {
+      return CachedProgramID;
+    }
+  }
+  
+  // Create the shaders
+  GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+  GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
   
   GLint Result = GL_FALSE;
   int InfoLogLength;
@@ -57,6 +272,9 @@ GLuint LoadShaders(const Rcpp::CharacterVector vertex_shader,
   GLuint ProgramID = glCreateProgram();
   glAttachShader(ProgramID, VertexShaderID);
   glAttachShader(ProgramID, FragmentShaderID);
+  if(!BinaryFile.empty()) {
+    glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glLinkProgram(ProgramID);
   
   // Check the program
@@ -74,5 +292,64 @@ GLuint LoadShaders(const Rcpp::CharacterVector vertex_shader,
   glDeleteShader(VertexShaderID);
   glDeleteShader(FragmentShaderID);
   
+  if(!BinaryFile.empty() && Result == GL_TRUE) {
+    saveProgramBinary(ProgramID, BinaryFile, BinaryKey);
+  }
   return ProgramID;
 }
+
+GLuint ProgramCache::get(const Rcpp::CharacterVector vertex_shader,
+                         const Rcpp::CharacterVector fragment_shader, bool verbose,
+                         const std::string& defines) {
+  //NUL separators keep e.g. ("ab","c") and ("a","bc") apart
+  std::string source = Rcpp::as<std::string>(vertex_shader);
+  source += '\0';
+  source += Rcpp::as<std::string>(fragment_shader);
+  source += '\0';
+  source += defines;
+  unsigned long long hash = hashSource(source);
+
+  std::unordered_map<unsigned long long, std::list<Entry>::iterator>::iterator found = index.find(hash);
+  if(found != index.end() && found->second->source == source) {
+    hits++;
+    entries.splice(entries.begin(), entries, found->second);
+    return(entries.front().program);
+  }
+  misses++;
+  GLuint program = LoadShaders(vertex_shader, fragment_shader, verbose, defines);
+  //Programs that failed to compile or link aren't kept, so fixing the source
+  //(or the driver state) and trying again always relinks
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE) {
+    glDeleteProgram(program);
+    return(0);
+  }
+  if(found != index.end()) {
+    //Hash collision: the older program loses its slot
+    glDeleteProgram(found->second->program);
+    entries.erase(found->second);
+    index.erase(found);
+  }
+  while(entries.size() >= capacity) {
+    glDeleteProgram(entries.back().program);
+    index.erase(entries.back().hash);
+    entries.pop_back();
+    evictions++;
+  }
+  Entry entry;
+  entry.hash = hash;
+  entry.source.swap(source);
+  entry.program = program;
+  entries.push_front(entry);
+  index[hash] = entries.begin();
+  return(program);
+}
+
+void ProgramCache::clear() {
+  for(std::list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+    glDeleteProgram(it->program);
+  }
+  entries.clear();
+  index.clear();
+}
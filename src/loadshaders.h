@@ -8,7 +8,50 @@
 //GLWF3 Installed with cmake, make install 
 #include <GLFW/glfw3.h>
 
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//`defines` (e.g. "#define TILED 1\n") is inserted into both shaders after the
+//#version line and any #extension directives
 GLuint LoadShaders(const Rcpp::CharacterVector vertex_shader, 
-                   const Rcpp::CharacterVector fragment_shader, bool verbose);
+                   const Rcpp::CharacterVector fragment_shader, bool verbose,
+                   const std::string& defines = std::string());
+
+//Linked programs are also written to (and reloaded from) this directory with
+//glGetProgramBinary/glProgramBinary; an empty path disables the on-disk cache.
+void SetProgramBinaryCacheDir(const std::string& dir);
+const std::string& GetProgramBinaryCacheDir();
+
+//Linked programs keyed by a hash of (vertex source, fragment source, defines),
+//so re-rendering a known shader skips compilation entirely. The least recently
+//used program is deleted once `capacity` programs are held. Programs belong to
+//the context that was current when they were linked; call clear() with that
+//context current before it is destroyed. get() returns 0 (and caches nothing)
+//if the program fails to compile or link.
+class ProgramCache {
+public:
+  ProgramCache(size_t capacity = 32) : capacity(capacity > 0 ? capacity : 1),
+    hits(0), misses(0), evictions(0) {}
+  GLuint get(const Rcpp::CharacterVector vertex_shader,
+             const Rcpp::CharacterVector fragment_shader, bool verbose,
+             const std::string& defines = std::string());
+  void clear();
+  size_t size() const { return entries.size(); }
+
+  size_t capacity;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+private:
+  struct Entry {
+    unsigned long long hash;
+    std::string source;
+    GLuint program;
+  };
+  //Most recently used first
+  std::list<Entry> entries;
+  std::unordered_map<unsigned long long, std::list<Entry>::iterator> index;
+};
   
 #endif
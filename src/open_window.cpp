@@ -9,35 +9,19 @@ using namespace Rcpp;
 #include "glm/gtx/transform.hpp" 
 #include "controls.h"
 #include "loadshaders.h"
+#include "context.h"
+#include "fullscreen.h"
 
 // [[Rcpp::export]]
 int open_window_rcpp(const CharacterVector vertex_shader, const CharacterVector fragment_shader,
                     int width, int height, int type, bool verbose) {
-  glfwInitHint(GLFW_COCOA_CHDIR_RESOURCES, GLFW_FALSE);
-  if(!glfwInit()){
-    return(-1);
-  }
   int nx = width;
   int ny = height;
-  glfwWindowHint(GLFW_SAMPLES, 4); // 4x antialiasing
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // We want OpenGL 3.3
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // We don't want the old OpenGL
-  GLFWwindow* window; // (In the accompanying source code, this variable is global for simplicity)
-  window = glfwCreateWindow( nx, ny, "shadr", NULL, NULL);
-  if( window == NULL ){
-    Rcpp::Rcout << "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n" ;
-    glfwTerminate();
-    return(-1);
-  }
-  glfwMakeContextCurrent(window); // Initialize GLEW
-  glewExperimental=true; // Needed in core profile
-  if (glewInit() != GLEW_OK) {
-    Rcpp::Rcout << "Failed to initialize GLEW\n";
+  RenderContext context;
+  if(!CreateRenderContext(context, nx, ny, SHADR_BACKEND_GLFW, verbose)) {
     return(-1);
   }
-  glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+  GLFWwindow* window = context.window;
   // Hide the mouse and enable unlimited movement
   // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   
@@ -45,42 +29,14 @@ int open_window_rcpp(const CharacterVector vertex_shader, const CharacterVector
   // glfwSetCursorPos(window, nx/2, ny/2);
   glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
   
-  GLuint VertexArrayID;
-  glGenVertexArrays(1, &VertexArrayID);
-  glBindVertexArray(VertexArrayID);
+  //The triangle, its attributes and the MVP block are recorded once here
+  FullscreenTriangle triangle;
+  CreateFullscreenTriangle(triangle);
   
   // Create and compile our GLSL program from the shaders
   GLuint programID = LoadShaders( vertex_shader, fragment_shader, verbose);
-  
-  GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-  glm::mat4 Projection = glm::ortho(-1.0f, 1.0f,-1.0f,1.0f, -0.5f, 1000.0f);
-  
-  // Camera matrix
-  glm::mat4 View       = glm::lookAt(
-    glm::vec3(0,0,-1), // Camera Location
-    glm::vec3(0,0,0), // Looks at the origin
-    glm::vec3(0,1,0)  // Camera up is +Y
-  );
-  glm::mat4 Model      = glm::mat4(1.0f);
-  glm::mat4 MVP        = Projection * View * Model; 
-  
-  static const GLfloat g_vertex_buffer_data[] = {
-    -1.0f,-1.0f, 0.0f,
-    1.0f,1.0f, 0.0f,
-    -1.0f, 1.0f, 0.0f,
-    -1.0f,-1.0f, 0.0f,
-    1.0f,-1.0f, 0.0f,
-    1.0f,1.0f, 0.0f
-  };
-  
-  static const GLfloat g_uv_buffer_data[] = {
-    0.0f, 0.0f,
-    1.0f, 1.0f,
-    1.0f, 0.0f,
-    0.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f
-  };
+  glUseProgram(programID);
+  SetFullscreenUniforms(programID);
   
   GLuint uTime;
   if(type == 1) {
@@ -100,22 +56,16 @@ int open_window_rcpp(const CharacterVector vertex_shader, const CharacterVector
   GLuint mousePos;
   mousePos = glGetUniformLocation(programID, "u_mouse");
   
-  GLuint vertexbuffer;
-  glGenBuffers(1, &vertexbuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
-  
-  GLuint uvbuffer;
-  glGenBuffers(1, &uvbuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(g_uv_buffer_data), g_uv_buffer_data, GL_STATIC_DRAW);
-  
   bool pause = false;
   double xpos, ypos;
   double debounce_time = 0.0;
+  //The viewport, resolution and mouse are only updated when they change
+  int width2 = -1, height2 = -1;
+  double mouse_x = -1, mouse_y = -1;
+  size_t frames = 0;
+  size_t calls_before = GLCalls();
 
   do{
-    // Clear the screen
     if(glfwGetTime() - debounce_time > 0.1) {
       if(!pause) {
         t += 0.01;
@@ -132,51 +82,22 @@ int open_window_rcpp(const CharacterVector vertex_shader, const CharacterVector
     
       
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // Use our shader
-    glUseProgram(programID);
+    int new_width, new_height;
+    glfwGetFramebufferSize(window, &new_width, &new_height);
+    if(new_width != width2 || new_height != height2) {
+      width2 = new_width;
+      height2 = new_height;
+      glViewport(0, 0, width2, height2);
+      glUniform2f(screenResolution, width2, height2);
+    }
+    if(xpos != mouse_x || ypos != mouse_y) {
+      mouse_x = xpos;
+      mouse_y = ypos;
+      glUniform2f(mousePos, xpos, ypos);
+    }
     glUniform1f(uTime, t);
-    
-    int width2, height2;
-    glfwGetFramebufferSize(window, &width2, &height2);
-    glViewport(0, 0, width2, height2);    
-    
-    glUniform2f(screenResolution, width2, height2);
-    glUniform2f(mousePos, xpos, ypos);
-    
-    // Send our transformation to the currently bound shader,
-    // in the "MVP" uniform
-    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glVertexAttribPointer(
-      0,                  // attribute. No particular reason for 0, but must match the layout in the shader.
-      3,                  // size
-      GL_FLOAT,           // type
-      GL_FALSE,           // normalized?
-      0,                  // stride
-      (void*)0            // array buffer offset
-    );
-    
-    // 2nd attribute buffer : UVs
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glVertexAttribPointer(
-      1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-      2,                                // size : U+V => 2
-      GL_FLOAT,                         // type
-      GL_FALSE,                         // normalized?
-      0,                                // stride
-      (void*)0                          // array buffer offset
-    );
-    
-    // Draw the triangle !
-    glDrawArrays(GL_TRIANGLES, 0, 2*3); // 12*3 indices starting at 0 -> 12 triangles
-    
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
+    DrawFullscreenTriangle();
+    frames++;
     
     // Swap buffers
     glfwSwapBuffers(window);
@@ -184,14 +105,15 @@ int open_window_rcpp(const CharacterVector vertex_shader, const CharacterVector
     
   } while(!glfwWindowShouldClose(window) && glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS);
   
-  glDeleteBuffers(1, &vertexbuffer);
-  glDeleteBuffers(1, &uvbuffer);
+  if(verbose && frames > 0) {
+    Rcpp::Rcout << "Drew " << frames << " frame(s) with "
+                << (double)(GLCalls() - calls_before) / frames
+                << " uniform and state GL calls each\n";
+  }
   glDeleteProgram(programID);
-  glDeleteVertexArrays(1, &VertexArrayID);
+  DestroyFullscreenTriangle(triangle);
   
   glfwWaitEvents();
-  glfwDestroyWindow(window);
-  glfwWaitEvents();
-  glfwTerminate();
+  DestroyRenderContext(context);
   return(1);
 }
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "png_compress.h"
+#include "checksum.h"
+#include "frame_alloc.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+//Uncompressed bytes per independently deflated chunk, and the deflate window
+//each chunk is primed with from the data before it
+#define PNG_COMPRESS_CHUNK (256 * 1024)
+#define DEFLATE_WINDOW 32768
+
+static int compress_threads = 1;
+
+void SetPngCompressThreads(int threads) {
+  compress_threads = threads > 0 ? threads : 1;
+}
+
+void ZlibHeader(int level, unsigned char* header) {
+  //CMF: deflate with a 32K window. FLG: compression level hint, then the
+  //check bits that make the pair a multiple of 31.
+  int flevel = level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3));
+  header[0] = 0x78;
+  header[1] = (unsigned char)(flevel << 6);
+  header[1] += (unsigned char)(31 - (header[0] * 256 + header[1]) % 31);
+}
+
+//zlib's state is only allocated when a stream is first set up (or changes
+//level); every allocation it makes shows up in FrameAllocations()
+static voidpf countedAlloc(voidpf, uInt items, uInt size) {
+  CountFrameAllocation();
+  return(calloc(items, size));
+}
+
+static void countedFree(voidpf, voidpf address) {
+  free(address);
+}
+
+//Threads that sleep between frames and each run the same function when
+//woken, so chunked compression doesn't start new threads for every frame
+class CompressHelpers {
+public:
+  explicit CompressHelpers(size_t n_threads) : generation(0), running(0), done(false),
+    work(NULL), job(NULL) {
+    for(size_t i = 0; i < n_threads; i++) {
+      CountFrameAllocation();
+      threads.push_back(std::thread(&CompressHelpers::loop, this));
+    }
+  }
+  ~CompressHelpers() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    wake.notify_all();
+    for(size_t i = 0; i < threads.size(); i++) {
+      threads[i].join();
+    }
+  }
+  size_t size() const { return threads.size(); }
+  //Starts work(job) on every helper; wait() returns once they have all finished
+  void start(void (*work)(void*), void* job) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      this->work = work;
+      this->job = job;
+      running = threads.size();
+      generation++;
+    }
+    wake.notify_all();
+  }
+  void wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this] { return running == 0; });
+  }
+
+private:
+  std::vector<std::thread> threads;
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  unsigned long generation;
+  size_t running;
+  bool done;
+  void (*work)(void*);
+  void* job;
+
+  void loop() {
+    unsigned long seen = 0;
+    while(true) {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [this, seen] { return done || generation != seen; });
+      if(done) {
+        return;
+      }
+      seen = generation;
+      void (*run)(void*) = work;
+      void* run_job = job;
+      guard.unlock();
+      run(run_job);
+      guard.lock();
+      if(--running == 0) {
+        finished.notify_one();
+      }
+    }
+  }
+};
+
+DeflateScratch::DeflateScratch() {}
+
+DeflateScratch::~DeflateScratch() {
+  helpers.reset();
+  for(size_t i = 0; i < chunks.size(); i++) {
+    if(chunks[i]->ready) {
+      deflateEnd(&chunks[i]->zs);
+    }
+  }
+}
+
+//One deflate stream per chunk and a helper per extra thread
+void DeflateScratch::prepare(size_t n_chunks, size_t n_threads) {
+  while(chunks.size() < n_chunks) {
+    CountFrameAllocation();
+    std::unique_ptr<Chunk> chunk(new Chunk);
+    std::memset(&chunk->zs, 0, sizeof(chunk->zs));
+    chunk->ready = false;
+    chunk->level = 0;
+    chunk->used = 0;
+    chunks.push_back(std::move(chunk));
+  }
+  size_t n_helpers = n_threads > 1 ? n_threads - 1 : 0;
+  if(n_helpers == 0) {
+    helpers.reset();
+  } else if(!helpers || helpers->size() != n_helpers) {
+    helpers.reset(new CompressHelpers(n_helpers));
+  }
+}
+
+//Raw-deflates data[start, start + len). Every chunk but the last ends on a
+//sync flush (an empty stored block, so it finishes byte aligned and the next
+//chunk's blocks can simply be appended); the last one sets BFINAL. Back
+//references into the previous chunk stay valid because it is preloaded as the
+//dictionary, so the ratio barely changes. A stream set up for an earlier
+//frame at the same level is reset rather than reallocated.
+bool DeflateScratch::deflateChunk(Chunk& chunk, const unsigned char* data, size_t start,
+                                  size_t len, int level, bool last) {
+  z_stream& zs = chunk.zs;
+  if(chunk.ready && chunk.level != level) {
+    deflateEnd(&zs);
+    chunk.ready = false;
+  }
+  if(chunk.ready) {
+    if(deflateReset(&zs) != Z_OK) {
+      return(false);
+    }
+  } else {
+    std::memset(&zs, 0, sizeof(zs));
+    zs.zalloc = countedAlloc;
+    zs.zfree = countedFree;
+    if(deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return(false);
+    }
+    chunk.ready = true;
+    chunk.level = level;
+  }
+  if(start > 0) {
+    size_t window = start < DEFLATE_WINDOW ? start : DEFLATE_WINDOW;
+    deflateSetDictionary(&zs, data + start - window, (uInt)window);
+  }
+  //deflateBound() doesn't count the sync flush marker
+  size_t bound = deflateBound(&zs, (uLong)len) + 16;
+  unsigned char* out = ReserveFrameBuffer(chunk.out, bound);
+  zs.next_in = (Bytef*)(data + start);
+  zs.avail_in = (uInt)len;
+  zs.next_out = out;
+  zs.avail_out = (uInt)bound;
+  int status = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+  bool ok = last ? status == Z_STREAM_END : (status == Z_OK && zs.avail_in == 0 && zs.avail_out > 0);
+  chunk.used = zs.total_out;
+  return(ok);
+}
+
+struct ChunkJob {
+  DeflateScratch* scratch;
+  const unsigned char* data;
+  size_t len;
+  size_t chunk_size;
+  size_t n_chunks;
+  int level;
+  std::atomic<size_t> next_chunk;
+  std::atomic<bool> failed;
+};
+
+//Chunks go to whichever thread is free next
+void DeflateScratch::deflateChunks(void* job) {
+  ChunkJob& chunk_job = *(ChunkJob*)job;
+  size_t i;
+  while((i = chunk_job.next_chunk++) < chunk_job.n_chunks) {
+    size_t start = i * chunk_job.chunk_size;
+    size_t size = i + 1 == chunk_job.n_chunks ? chunk_job.len - start : chunk_job.chunk_size;
+    if(!chunk_job.scratch->deflateChunk(*chunk_job.scratch->chunks[i], chunk_job.data, start,
+                                        size, chunk_job.level, i + 1 == chunk_job.n_chunks)) {
+      chunk_job.failed = true;
+    }
+  }
+}
+
+//Chunks are only split off for threads to deflate, exactly as PngCompress()
+//will, so a reserved scratch allocates nothing for its first frame either
+void DeflateScratch::reserve(size_t len, int level) {
+  level = level < 0 ? Z_DEFAULT_COMPRESSION : (level > 9 ? 9 : level);
+  size_t n_chunks = len > 0 ? (len + PNG_COMPRESS_CHUNK - 1) / PNG_COMPRESS_CHUNK : 1;
+  size_t n_threads = (size_t)compress_threads < n_chunks ? (size_t)compress_threads : n_chunks;
+  if(n_threads <= 1) {
+    n_chunks = 1;
+  }
+  size_t chunk_size = n_chunks > 1 ? PNG_COMPRESS_CHUNK : len;
+  prepare(n_chunks, n_threads);
+  size_t total = 6;
+  for(size_t i = 0; i < n_chunks; i++) {
+    Chunk& chunk = *chunks[i];
+    size_t size = i + 1 == n_chunks ? len - i * chunk_size : chunk_size;
+    //Setting up the stream is all deflateChunk() would allocate
+    unsigned char empty = 0;
+    if(!deflateChunk(chunk, &empty, 0, 0, level, true)) {
+      return;
+    }
+    size_t bound = deflateBound(&chunk.zs, (uLong)size) + 16;
+    ReserveFrameBuffer(chunk.out, bound);
+    total += bound;
+  }
+  ReserveFrameBuffer(out, total);
+}
+
+//Big frames are split into chunks that are deflated on SetPngCompressThreads()
+//threads (pigz-style) and stitched back into one zlib stream. The header and
+//Adler-32 trailer are added here so the checksum runs through Adler32().
+const unsigned char* PngCompress(const unsigned char* data, size_t data_len,
+                                 size_t* out_len, int level, DeflateScratch& scratch) {
+  level = level < 0 ? Z_DEFAULT_COMPRESSION : (level > 9 ? 9 : level);
+  size_t len = data_len;
+  size_t n_chunks = len > 0 ? (len + PNG_COMPRESS_CHUNK - 1) / PNG_COMPRESS_CHUNK : 1;
+  size_t n_threads = (size_t)compress_threads < n_chunks ? (size_t)compress_threads : n_chunks;
+  if(n_threads <= 1) {
+    n_chunks = 1;
+  }
+  scratch.prepare(n_chunks, n_threads);
+
+  ChunkJob job;
+  job.scratch = &scratch;
+  job.data = data;
+  job.len = len;
+  job.chunk_size = n_chunks > 1 ? PNG_COMPRESS_CHUNK : len;
+  job.n_chunks = n_chunks;
+  job.level = level;
+  job.next_chunk = 0;
+  job.failed = false;
+  if(scratch.helpers) {
+    scratch.helpers->start(DeflateScratch::deflateChunks, &job);
+  }
+  DeflateScratch::deflateChunks(&job);
+  unsigned int adler = Adler32(1, data, len);
+  if(scratch.helpers) {
+    scratch.helpers->wait();
+  }
+  if(job.failed) {
+    return(NULL);
+  }
+
+  size_t size = 2;
+  for(size_t i = 0; i < n_chunks; i++) {
+    size += scratch.chunks[i]->used;
+  }
+  unsigned char* out = ReserveFrameBuffer(scratch.out, size + 4);
+  ZlibHeader(level < 0 ? 6 : level, out);
+  size = 2;
+  for(size_t i = 0; i < n_chunks; i++) {
+    std::memcpy(out + size, scratch.chunks[i]->out.data(), scratch.chunks[i]->used);
+    size += scratch.chunks[i]->used;
+  }
+  out[size++] = (unsigned char)(adler >> 24);
+  out[size++] = (unsigned char)(adler >> 16);
+  out[size++] = (unsigned char)(adler >> 8);
+  out[size++] = (unsigned char)adler;
+  *out_len = size;
+  return(out);
+}
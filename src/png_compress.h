@@ -0,0 +1,59 @@
+#ifndef PNGCOMPRESSH
+#define PNGCOMPRESSH
+
+#include <zlib.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class CompressHelpers;
+
+//Everything PngCompress() needs on one thread, kept from frame to frame: a
+//deflate stream and output buffer per chunk, the assembled zlib stream, and
+//the helper threads chunks are deflated on. Once it has compressed a frame
+//(or after reserve()), frames of the same size allocate nothing.
+class DeflateScratch {
+public:
+  DeflateScratch();
+  ~DeflateScratch();
+  //Sizes everything for `len` input bytes at zlib `level` with the current
+  //SetPngCompressThreads() setting
+  void reserve(size_t len, int level);
+
+private:
+  //Chunks hold a live z_stream, which zlib's state points back to, so they
+  //are never moved
+  struct Chunk {
+    z_stream zs;
+    bool ready;
+    int level;
+    std::vector<unsigned char> out;
+    size_t used;
+  };
+  std::vector<std::unique_ptr<Chunk> > chunks;
+  std::vector<unsigned char> out;
+  std::unique_ptr<CompressHelpers> helpers;
+
+  void prepare(size_t n_chunks, size_t n_threads);
+  bool deflateChunk(Chunk& chunk, const unsigned char* data, size_t start, size_t len,
+                    int level, bool last);
+  static void deflateChunks(void* job);
+  friend const unsigned char* PngCompress(const unsigned char* data, size_t data_len,
+                                          size_t* out_len, int level, DeflateScratch& scratch);
+};
+
+//Deflates `data` into a complete zlib stream at zlib `level` (0 writes stored
+//blocks, 1 is fastest, 9 smallest, -1 zlib's default). The stream lives in
+//`scratch` and stays valid until its next call; returns NULL on failure.
+const unsigned char* PngCompress(const unsigned char* data, size_t data_len,
+                                 size_t* out_len, int level, DeflateScratch& scratch);
+
+//Threads each PngCompress() call may use; set it on the render thread before
+//any frames are encoded
+void SetPngCompressThreads(int threads);
+
+//Two byte zlib stream header for a raw deflate stream at `level`; the
+//Adler-32 trailer is computed separately with Adler32()
+void ZlibHeader(int level, unsigned char* header);
+
+#endif
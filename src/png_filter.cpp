@@ -0,0 +1,262 @@
+#include "png_filter.h"
+#include <cstdlib>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHADR_X86_SIMD
+#include <immintrin.h>
+#endif
+
+//Bytes per RGB pixel: filters predict from the same channel one pixel left
+#define PNG_BPP 3
+
+static inline unsigned char paethPredict(int a, int b, int c) {
+  int pa = std::abs(b - c);
+  int pb = std::abs(a - c);
+  int pc = std::abs(a + b - 2 * c);
+  if(pa <= pb && pa <= pc) {
+    return((unsigned char)a);
+  }
+  return((unsigned char)(pb <= pc ? b : c));
+}
+
+static inline unsigned char filterByte(int type, int x, int a, int b, int c) {
+  switch(type) {
+    case 0: return((unsigned char)x);
+    case 1: return((unsigned char)(x - a));
+    case 2: return((unsigned char)(x - b));
+    case 3: return((unsigned char)(x - ((a + b) >> 1)));
+    default: return((unsigned char)(x - paethPredict(a, b, c)));
+  }
+}
+
+//Filters bytes [start, end) of the row; the first PNG_BPP bytes have no left neighbour
+static void filterSpan(int type, const unsigned char* row, const unsigned char* prev,
+                       int start, int end, unsigned char* out) {
+  for(int i = start; i < end; i++) {
+    int a = i >= PNG_BPP ? row[i - PNG_BPP] : 0;
+    int c = i >= PNG_BPP ? prev[i - PNG_BPP] : 0;
+    out[i] = filterByte(type, row[i], a, prev[i], c);
+  }
+}
+
+static void scoreSpan(const unsigned char* row, const unsigned char* prev,
+                      int start, int end, unsigned long long* scores) {
+  for(int i = start; i < end; i++) {
+    int a = i >= PNG_BPP ? row[i - PNG_BPP] : 0;
+    int c = i >= PNG_BPP ? prev[i - PNG_BPP] : 0;
+    for(int type = 0; type < 5; type++) {
+      scores[type] += std::abs((int)(signed char)filterByte(type, row[i], a, prev[i], c));
+    }
+  }
+}
+
+static int bestFilter(const unsigned long long* scores) {
+  int best = 0;
+  for(int type = 1; type < 5; type++) {
+    if(scores[type] < scores[best]) {
+      best = type;
+    }
+  }
+  return(best);
+}
+
+int FilterPngRowScalar(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                       int filter, unsigned char* out) {
+  if(filter < 0 || filter > 4) {
+    unsigned long long scores[5] = {0, 0, 0, 0, 0};
+    scoreSpan(row, prev, 0, n_bytes, scores);
+    filter = bestFilter(scores);
+  }
+  out[0] = (unsigned char)filter;
+  filterSpan(filter, row, prev, 0, n_bytes, out + 1);
+  return(filter);
+}
+
+#ifdef SHADR_X86_SIMD
+//Both kernels work on 16 (SSE2) or 32 (AVX2) bytes at a time from byte
+//PNG_BPP on. Encoding only ever reads unfiltered bytes, so unlike decoding
+//there is no dependency between neighbouring pixels. Scoring computes all five
+//filters from one set of loads; the winner is then applied in a second pass.
+
+//Paeth predictor on 16-bit lanes: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+__attribute__((target("sse2")))
+static inline __m128i paeth16Sse2(__m128i a, __m128i b, __m128i c) {
+  __m128i bc = _mm_sub_epi16(b, c);
+  __m128i ac = _mm_sub_epi16(a, c);
+  __m128i abc = _mm_add_epi16(ac, bc);
+  __m128i zero = _mm_setzero_si128();
+  __m128i pa = _mm_max_epi16(bc, _mm_sub_epi16(zero, bc));
+  __m128i pb = _mm_max_epi16(ac, _mm_sub_epi16(zero, ac));
+  __m128i pc = _mm_max_epi16(abc, _mm_sub_epi16(zero, abc));
+  __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+  __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+  __m128i b_or_c = _mm_or_si128(_mm_and_si128(use_c, c), _mm_andnot_si128(use_c, b));
+  return(_mm_or_si128(_mm_and_si128(not_a, b_or_c), _mm_andnot_si128(not_a, a)));
+}
+
+//Filtered output of all five types for 16 bytes
+__attribute__((target("sse2")))
+static inline void filtersSse2(const unsigned char* row, const unsigned char* prev, int i,
+                               __m128i* f) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+  __m128i a = _mm_loadu_si128((const __m128i*)(row + i - PNG_BPP));
+  __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+  __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - PNG_BPP));
+  //floor((a + b) / 2): _mm_avg_epu8 rounds up
+  __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+                             _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+  __m128i lo = paeth16Sse2(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+                           _mm_unpacklo_epi8(c, zero));
+  __m128i hi = paeth16Sse2(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+                           _mm_unpackhi_epi8(c, zero));
+  f[0] = x;
+  f[1] = _mm_sub_epi8(x, a);
+  f[2] = _mm_sub_epi8(x, b);
+  f[3] = _mm_sub_epi8(x, avg);
+  f[4] = _mm_sub_epi8(x, _mm_packus_epi16(lo, hi));
+}
+
+__attribute__((target("sse2")))
+static int filterRowSse2(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                         int filter, unsigned char* out) {
+  int end = PNG_BPP + (n_bytes > PNG_BPP ? (n_bytes - PNG_BPP) / 16 * 16 : 0);
+  __m128i f[5];
+  if(filter < 0 || filter > 4) {
+    unsigned long long scores[5] = {0, 0, 0, 0, 0};
+    __m128i sums[5];
+    for(int type = 0; type < 5; type++) {
+      sums[type] = _mm_setzero_si128();
+    }
+    __m128i zero = _mm_setzero_si128();
+    for(int i = PNG_BPP; i < end; i += 16) {
+      filtersSse2(row, prev, i, f);
+      for(int type = 0; type < 5; type++) {
+        //|signed byte| is min(u, -u) taken as unsigned bytes
+        __m128i abs8 = _mm_min_epu8(f[type], _mm_sub_epi8(zero, f[type]));
+        sums[type] = _mm_add_epi64(sums[type], _mm_sad_epu8(abs8, zero));
+      }
+    }
+    for(int type = 0; type < 5; type++) {
+      scores[type] = (unsigned long long)_mm_cvtsi128_si32(sums[type]) +
+                     (unsigned long long)_mm_cvtsi128_si32(_mm_srli_si128(sums[type], 8));
+    }
+    scoreSpan(row, prev, 0, n_bytes < PNG_BPP ? n_bytes : PNG_BPP, scores);
+    scoreSpan(row, prev, end, n_bytes, scores);
+    filter = bestFilter(scores);
+  }
+  out[0] = (unsigned char)filter;
+  out++;
+  filterSpan(filter, row, prev, 0, n_bytes < PNG_BPP ? n_bytes : PNG_BPP, out);
+  for(int i = PNG_BPP; i < end; i += 16) {
+    filtersSse2(row, prev, i, f);
+    _mm_storeu_si128((__m128i*)(out + i), f[filter]);
+  }
+  filterSpan(filter, row, prev, end, n_bytes, out);
+  return(filter);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i paeth16Avx2(__m256i a, __m256i b, __m256i c) {
+  __m256i bc = _mm256_sub_epi16(b, c);
+  __m256i ac = _mm256_sub_epi16(a, c);
+  __m256i pa = _mm256_abs_epi16(bc);
+  __m256i pb = _mm256_abs_epi16(ac);
+  __m256i pc = _mm256_abs_epi16(_mm256_add_epi16(ac, bc));
+  __m256i not_a = _mm256_or_si256(_mm256_cmpgt_epi16(pa, pb), _mm256_cmpgt_epi16(pa, pc));
+  __m256i b_or_c = _mm256_blendv_epi8(b, c, _mm256_cmpgt_epi16(pb, pc));
+  return(_mm256_blendv_epi8(a, b_or_c, not_a));
+}
+
+//Unpack/pack work within 128-bit lanes, so the byte order survives the round trip
+__attribute__((target("avx2")))
+static inline void filtersAvx2(const unsigned char* row, const unsigned char* prev, int i,
+                               __m256i* f) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i x = _mm256_loadu_si256((const __m256i*)(row + i));
+  __m256i a = _mm256_loadu_si256((const __m256i*)(row + i - PNG_BPP));
+  __m256i b = _mm256_loadu_si256((const __m256i*)(prev + i));
+  __m256i c = _mm256_loadu_si256((const __m256i*)(prev + i - PNG_BPP));
+  __m256i avg = _mm256_sub_epi8(_mm256_avg_epu8(a, b),
+                                _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi8(1)));
+  __m256i lo = paeth16Avx2(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero),
+                           _mm256_unpacklo_epi8(c, zero));
+  __m256i hi = paeth16Avx2(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero),
+                           _mm256_unpackhi_epi8(c, zero));
+  f[0] = x;
+  f[1] = _mm256_sub_epi8(x, a);
+  f[2] = _mm256_sub_epi8(x, b);
+  f[3] = _mm256_sub_epi8(x, avg);
+  f[4] = _mm256_sub_epi8(x, _mm256_packus_epi16(lo, hi));
+}
+
+__attribute__((target("avx2")))
+static int filterRowAvx2(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                         int filter, unsigned char* out) {
+  int end = PNG_BPP + (n_bytes > PNG_BPP ? (n_bytes - PNG_BPP) / 32 * 32 : 0);
+  __m256i f[5];
+  if(filter < 0 || filter > 4) {
+    unsigned long long scores[5] = {0, 0, 0, 0, 0};
+    __m256i sums[5];
+    for(int type = 0; type < 5; type++) {
+      sums[type] = _mm256_setzero_si256();
+    }
+    __m256i zero = _mm256_setzero_si256();
+    for(int i = PNG_BPP; i < end; i += 32) {
+      filtersAvx2(row, prev, i, f);
+      for(int type = 0; type < 5; type++) {
+        __m256i abs8 = _mm256_abs_epi8(f[type]);
+        sums[type] = _mm256_add_epi64(sums[type], _mm256_sad_epu8(abs8, zero));
+      }
+    }
+    for(int type = 0; type < 5; type++) {
+      __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums[type]),
+                                  _mm256_extracti128_si256(sums[type], 1));
+      scores[type] = (unsigned long long)_mm_cvtsi128_si32(sum) +
+                     (unsigned long long)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    }
+    scoreSpan(row, prev, 0, n_bytes < PNG_BPP ? n_bytes : PNG_BPP, scores);
+    scoreSpan(row, prev, end, n_bytes, scores);
+    filter = bestFilter(scores);
+  }
+  out[0] = (unsigned char)filter;
+  out++;
+  filterSpan(filter, row, prev, 0, n_bytes < PNG_BPP ? n_bytes : PNG_BPP, out);
+  for(int i = PNG_BPP; i < end; i += 32) {
+    filtersAvx2(row, prev, i, f);
+    _mm256_storeu_si256((__m256i*)(out + i), f[filter]);
+  }
+  filterSpan(filter, row, prev, end, n_bytes, out);
+  return(filter);
+}
+#endif
+
+static FilterFunction selectFilter() {
+  //The last kernel is the widest this CPU has
+  return(PngFilterKernels().back().function);
+}
+
+std::vector<FilterKernel> PngFilterKernels() {
+  std::vector<FilterKernel> kernels;
+  FilterKernel scalar = {"scalar", FilterPngRowScalar};
+  kernels.push_back(scalar);
+#ifdef SHADR_X86_SIMD
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse2")) {
+    FilterKernel sse2 = {"sse2", filterRowSse2};
+    kernels.push_back(sse2);
+  }
+  if(__builtin_cpu_supports("avx2")) {
+    FilterKernel avx2 = {"avx2", filterRowAvx2};
+    kernels.push_back(avx2);
+  }
+#endif
+  return(kernels);
+}
+
+int FilterPngRow(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                 int filter, unsigned char* out) {
+  //Initialized exactly once, even with several encode threads (C++11)
+  static const FilterFunction filter_row = selectFilter();
+  return(filter_row(row, prev, n_bytes, filter, out));
+}
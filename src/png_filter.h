@@ -0,0 +1,29 @@
+#ifndef PNGFILTERH
+#define PNGFILTERH
+
+#include <vector>
+
+//Filters one 8-bit RGB scanline for PNG. `filter` is the PNG filter type to
+//apply (0 none, 1 sub, 2 up, 3 average, 4 paeth) or -1 to pick the one with
+//the smallest sum of absolute (signed) output bytes, the heuristic libpng and
+//stb_image_write use. `prev` is the unfiltered row above (all zeros for the
+//first row). Writes the filter type byte and `n_bytes` filtered bytes to
+//`out` and returns the filter used. SSE2/AVX2 kernels are picked once per
+//process from the CPU, with a scalar fallback.
+int FilterPngRow(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                 int filter, unsigned char* out);
+
+//The portable version, always available
+int FilterPngRowScalar(const unsigned char* row, const unsigned char* prev, int n_bytes,
+                       int filter, unsigned char* out);
+
+//Every row filter this CPU can run, the scalar one first, so the SIMD kernels
+//can be checked against it
+typedef int (*FilterFunction)(const unsigned char*, const unsigned char*, int, int, unsigned char*);
+struct FilterKernel {
+  const char* name;
+  FilterFunction function;
+};
+std::vector<FilterKernel> PngFilterKernels();
+
+#endif
@@ -0,0 +1,212 @@
+#include <Rcpp.h>
+
+#include "png_stream.h"
+#include "png_compress.h"
+#include "png_filter.h"
+#include "checksum.h"
+#include "frame_alloc.h"
+#include <cstdlib>
+#include <cstring>
+
+//Compressed bytes per IDAT chunk
+#define PNG_STREAM_CHUNK 65536
+//stdio buffer WritePng() writes files through
+#define PNG_IO_BUFFER 65536
+
+static void putBigEndian(unsigned char* p, unsigned int v) {
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+static int png_level = 6;
+static int png_filter = -1;
+
+void SetPngOptions(int level, int filter, int threads) {
+  png_level = level;
+  png_filter = filter;
+  SetPngCompressThreads(threads);
+}
+
+static bool writeChunk(FILE* f, const char* type, const unsigned char* data, size_t size) {
+  unsigned char header[8];
+  putBigEndian(header, (unsigned int)size);
+  std::memcpy(header + 4, type, 4);
+  unsigned int crc = Crc32(0, (const unsigned char*)type, 4);
+  crc = Crc32(crc, data, size);
+  unsigned char footer[4];
+  putBigEndian(footer, crc);
+  return(fwrite(header, 1, 8, f) == 8 &&
+         (size == 0 || fwrite(data, 1, size, f) == size) &&
+         fwrite(footer, 1, 4, f) == 4);
+}
+
+static bool writeHeader(FILE* f, int width, int height) {
+  static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  unsigned char ihdr[13];
+  putBigEndian(ihdr, (unsigned int)width);
+  putBigEndian(ihdr + 4, (unsigned int)height);
+  ihdr[8] = 8;  //bit depth
+  ihdr[9] = 2;  //color type: RGB
+  ihdr[10] = 0; //compression
+  ihdr[11] = 0; //filter method
+  ihdr[12] = 0; //no interlace
+  return(fwrite(signature, 1, 8, f) == 8 && writeChunk(f, "IHDR", ihdr, 13));
+}
+
+void PngScratch::reserve(int width, int height) {
+  size_t n_bytes = (size_t)width * 3;
+  ReserveFrameBuffer(filtered, (n_bytes + 1) * height);
+  ReserveFrameBuffer(zeros, n_bytes);
+  ReserveFrameBuffer(io, PNG_IO_BUFFER);
+  deflate.reserve((n_bytes + 1) * height, png_level);
+}
+
+//Filters every row into one buffer, deflates it (in parallel chunks for big
+//frames) and writes it as a single IDAT chunk
+bool WritePng(const std::string& file, int width, int height,
+              const unsigned char* pixels, long stride, PngScratch& scratch) {
+  size_t n_bytes = (size_t)width * 3;
+  size_t filtered_size = (n_bytes + 1) * height;
+  unsigned char* filtered = ReserveFrameBuffer(scratch.filtered, filtered_size);
+  const unsigned char* prev = ReserveFrameBuffer(scratch.zeros, n_bytes);
+  for(int y = 0; y < height; y++) {
+    const unsigned char* row = pixels + y * stride;
+    FilterPngRow(row, prev, (int)n_bytes, png_filter, filtered + y * (n_bytes + 1));
+    prev = row;
+  }
+  size_t zlib_size = 0;
+  const unsigned char* zlib = PngCompress(filtered, filtered_size, &zlib_size, png_level,
+                                          scratch.deflate);
+  if(!zlib) {
+    return(false);
+  }
+  FILE* f = fopen(file.c_str(), "wb");
+  if(f) {
+    setvbuf(f, ReserveFrameBuffer(scratch.io, PNG_IO_BUFFER), _IOFBF, PNG_IO_BUFFER);
+  }
+  bool ok = f != NULL && writeHeader(f, width, height) &&
+    writeChunk(f, "IDAT", zlib, zlib_size) && writeChunk(f, "IEND", NULL, 0);
+  if(f) {
+    ok = fclose(f) == 0 && ok;
+  }
+  return(ok);
+}
+
+PngStream::PngStream() : f(NULL), width(0), height(0), rows_written(0), deflating(false) {}
+
+PngStream::~PngStream() {
+  abort();
+}
+
+bool PngStream::open(const std::string& file, int width, int height) {
+  abort();
+  this->file = file;
+  this->width = width;
+  this->height = height;
+  rows_written = 0;
+  f = fopen(file.c_str(), "wb");
+  if(!f) {
+    Rcpp::Rcout << "Failed to open " << file << " for writing\n";
+    return(false);
+  }
+  //Raw deflate; the zlib header and Adler-32 trailer are written here
+  std::memset(&zs, 0, sizeof(zs));
+  if(deflateInit2(&zs, png_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    abort();
+    return(false);
+  }
+  deflating = true;
+  adler = 1;
+  size_t n_bytes = (size_t)width * 3;
+  prev_row.assign(n_bytes, 0);
+  filtered.resize(n_bytes + 1);
+  out.resize(PNG_STREAM_CHUNK);
+  ZlibHeader(png_level < 0 ? 6 : png_level, out.data());
+  zs.next_out = out.data() + 2;
+  zs.avail_out = (uInt)out.size() - 2;
+
+  if(!writeHeader(f, width, height)) {
+    abort();
+    return(false);
+  }
+  return(true);
+}
+
+bool PngStream::writeRows(const unsigned char* rows, int n_rows, long stride) {
+  if(!f) {
+    return(false);
+  }
+  int n_bytes = width * 3;
+  for(int y = 0; y < n_rows && rows_written < height; y++, rows_written++) {
+    const unsigned char* row = rows + y * stride;
+    FilterPngRow(row, prev_row.data(), n_bytes, png_filter, filtered.data());
+    std::memcpy(prev_row.data(), row, n_bytes);
+    adler = Adler32(adler, filtered.data(), filtered.size());
+    if(!deflateBuffer(filtered.data(), filtered.size(), Z_NO_FLUSH)) {
+      abort();
+      return(false);
+    }
+  }
+  return(true);
+}
+
+bool PngStream::close() {
+  if(!f) {
+    return(false);
+  }
+  if(rows_written < height) {
+    Rcpp::Rcout << "Only " << rows_written << " of " << height << " rows were written to " << file << "\n";
+    abort();
+    return(false);
+  }
+  unsigned char trailer[4];
+  putBigEndian(trailer, adler);
+  if(!deflateBuffer(NULL, 0, Z_FINISH) || !writeChunk(f, "IDAT", trailer, 4) ||
+     !writeChunk(f, "IEND", NULL, 0)) {
+    abort();
+    return(false);
+  }
+  deflateEnd(&zs);
+  deflating = false;
+  bool ok = fclose(f) == 0;
+  f = NULL;
+  return(ok);
+}
+
+//Runs `data` through the zlib stream, writing an IDAT chunk every time the
+//output buffer fills (and whatever is left over on Z_FINISH)
+bool PngStream::deflateBuffer(const unsigned char* data, size_t size, int flush) {
+  zs.next_in = (Bytef*)data;
+  zs.avail_in = (uInt)size;
+  int status;
+  do {
+    status = deflate(&zs, flush);
+    if(status == Z_STREAM_ERROR) {
+      return(false);
+    }
+    size_t n_out = out.size() - zs.avail_out;
+    if(zs.avail_out == 0 || (flush == Z_FINISH && n_out > 0)) {
+      if(!writeChunk(f, "IDAT", out.data(), n_out)) {
+        return(false);
+      }
+      zs.next_out = out.data();
+      zs.avail_out = (uInt)out.size();
+    }
+  } while(zs.avail_in > 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+  return(true);
+}
+
+//Drops a partially written image
+void PngStream::abort() {
+  if(deflating) {
+    deflateEnd(&zs);
+    deflating = false;
+  }
+  if(f) {
+    fclose(f);
+    f = NULL;
+    std::remove(file.c_str());
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef PNGSTREAMH
+#define PNGSTREAMH
+
+#include "png_compress.h"
+#include <zlib.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//Frame encoder settings: the zlib level, the PNG filter forced on every row
+//(or -1 to choose per row), and the threads each frame is deflated on. They
+//are process-wide, so set them on the render thread before any frames are
+//encoded.
+void SetPngOptions(int level, int filter, int threads);
+
+//Buffers WritePng() reuses from one image to the next on the same thread:
+//filtered rows, the deflate scratch, and the stdio buffer the file is
+//written through
+struct PngScratch {
+  //Sizes everything for width x height images with the current options
+  void reserve(int width, int height);
+  std::vector<unsigned char> filtered;
+  std::vector<unsigned char> zeros;
+  std::vector<char> io;
+  DeflateScratch deflate;
+};
+
+//Writes an 8-bit RGB image as a PNG. `pixels` points at the top row; `stride`
+//may be negative for bottom-up (OpenGL) row order.
+bool WritePng(const std::string& file, int width, int height,
+              const unsigned char* pixels, long stride, PngScratch& scratch);
+
+//Writes an 8-bit RGB PNG a band of rows at a time, so images too big to hold
+//in memory (tiled posters) never have to be assembled in one buffer. Rows are
+//filtered and fed through a single zlib stream, and compressed data goes out
+//as an IDAT chunk whenever the output buffer fills.
+class PngStream {
+public:
+  PngStream();
+  ~PngStream();
+  bool open(const std::string& file, int width, int height);
+  //`rows` points at the top row of the band; `stride` may be negative for
+  //bottom-up (OpenGL) row order
+  bool writeRows(const unsigned char* rows, int n_rows, long stride);
+  //Fails if fewer than `height` rows were written
+  bool close();
+
+private:
+  FILE* f;
+  std::string file;
+  int width;
+  int height;
+  int rows_written;
+  z_stream zs;
+  bool deflating;
+  unsigned int adler;
+  std::vector<unsigned char> prev_row;
+  std::vector<unsigned char> filtered;
+  std::vector<unsigned char> out;
+
+  bool deflateBuffer(const unsigned char* data, size_t size, int flush);
+  void abort();
+};
+
+#endif
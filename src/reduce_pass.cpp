@@ -0,0 +1,281 @@
+#include <Rcpp.h>
+
+#include "reduce_pass.h"
+#include "loadshaders.h"
+#include <algorithm>
+
+//Each reduction pass is a fullscreen triangle from gl_VertexID
+static const char* reduce_vertex_shader =
+  "#version 330 core\n"
+  "void main(){\n"
+  "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+  "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+//Folds the 4x4 block of the input (`size` texels) under each output texel.
+//The first pass binds the frame itself to all three inputs.
+static const char* reduce_fragment_shader =
+  "#version 330 core\n"
+  "uniform sampler2D min_in;\n"
+  "uniform sampler2D max_in;\n"
+  "uniform sampler2D sum_in;\n"
+  "uniform ivec2 size;\n"
+  "layout(location = 0) out vec4 min_out;\n"
+  "layout(location = 1) out vec4 max_out;\n"
+  "layout(location = 2) out vec4 sum_out;\n"
+  "void main(){\n"
+  "  ivec2 base = ivec2(gl_FragCoord.xy) * 4;\n"
+  "  vec4 lo = texelFetch(min_in, base, 0);\n"
+  "  vec4 hi = texelFetch(max_in, base, 0);\n"
+  "  vec4 total = vec4(0.0);\n"
+  "  for(int y = 0; y < 4; y++) {\n"
+  "    for(int x = 0; x < 4; x++) {\n"
+  "      ivec2 p = base + ivec2(x, y);\n"
+  "      if(p.x < size.x && p.y < size.y) {\n"
+  "        lo = min(lo, texelFetch(min_in, p, 0));\n"
+  "        hi = max(hi, texelFetch(max_in, p, 0));\n"
+  "        total += texelFetch(sum_in, p, 0);\n"
+  "      }\n"
+  "    }\n"
+  "  }\n"
+  "  min_out = lo;\n"
+  "  max_out = hi;\n"
+  "  sum_out = total;\n"
+  "}\n";
+
+//Vertex i (of width * height) and instance c (0-2) place channel c of pixel i
+//as a point over its bin in one of the channel's HISTOGRAM_COPIES rows (picked
+//by the pixel's row), or outside the viewport if it isn't binned
+static const char* histogram_vertex_shader =
+  "#version 330 core\n"
+  "uniform sampler2D frame;\n"
+  "uniform int frame_width;\n"
+  "uniform vec2 range;\n"
+  "uniform int bins;\n"
+  "uniform int copies;\n"
+  "void main(){\n"
+  "  ivec2 p = ivec2(gl_VertexID % frame_width, gl_VertexID / frame_width);\n"
+  "  float f = (texelFetch(frame, p, 0)[gl_InstanceID] - range.x) / (range.y - range.x);\n"
+  "  int bin = min(int(floor(f * float(bins))), bins - 1);\n"
+  "  int row = gl_InstanceID * copies + p.y % copies;\n"
+  "  vec2 center = (vec2(bin, row) + 0.5) / vec2(bins, 3 * copies);\n"
+  "  gl_Position = f >= 0.0 && f <= 1.0 ? vec4(center * 2.0 - 1.0, 0.0, 1.0) : vec4(2.0, 2.0, 0.0, 1.0);\n"
+  "}\n";
+
+static const char* histogram_fragment_shader =
+  "#version 330 core\n"
+  "out float count;\n"
+  "void main(){\n"
+  "  count = 1.0;\n"
+  "}\n";
+
+//The GPU passes stop once a level has at most this many texels, which are
+//read back and folded on the CPU in double precision. Each texel of the sum
+//then holds a float sum of only a few hundred to a few thousand pixels.
+#define REDUCE_CPU_TEXELS 1024
+
+//Points blended into the same texel are serialized, so each bin is counted
+//in this many rows and the rows are summed after reading them back
+#define HISTOGRAM_COPIES 64
+
+static GLuint newFloatTexture(GLenum format, int width, int height) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+               format == GL_R32F ? GL_RED : GL_RGBA, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  return(texture);
+}
+
+bool ReducePass::create(int width, int height, int bins, bool verbose) {
+  if(reduce_program && width == this->width && height == this->height && bins == this->bins) {
+    return(true);
+  }
+  destroy();
+  reduce_program = LoadShaders(Rcpp::CharacterVector(reduce_vertex_shader),
+                               Rcpp::CharacterVector(reduce_fragment_shader), verbose);
+  histogram_program = LoadShaders(Rcpp::CharacterVector(histogram_vertex_shader),
+                                  Rcpp::CharacterVector(histogram_fragment_shader), verbose);
+  if(!reduce_program || !histogram_program) {
+    if(reduce_program) {
+      glDeleteProgram(reduce_program);
+      reduce_program = 0;
+    }
+    if(histogram_program) {
+      glDeleteProgram(histogram_program);
+      histogram_program = 0;
+    }
+    return(false);
+  }
+  this->width = width;
+  this->height = height;
+  this->bins = bins;
+  GLint previous_framebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  size_location = glGetUniformLocation(reduce_program, "size");
+  input_locations[0] = glGetUniformLocation(reduce_program, "min_in");
+  input_locations[1] = glGetUniformLocation(reduce_program, "max_in");
+  input_locations[2] = glGetUniformLocation(reduce_program, "sum_in");
+  frame_location = glGetUniformLocation(histogram_program, "frame");
+  frame_width_location = glGetUniformLocation(histogram_program, "frame_width");
+  range_location = glGetUniformLocation(histogram_program, "range");
+  bins_location = glGetUniformLocation(histogram_program, "bins");
+  copies_location = glGetUniformLocation(histogram_program, "copies");
+  glGenVertexArrays(1, &vertex_array);
+
+  //The rendered frame is copied here so it can be sampled
+  source_texture = newFloatTexture(GL_RGBA32F, width, height);
+  glGenFramebuffers(1, &source_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, source_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source_texture, 0);
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+  //Every pass after the first writes to a corner of these
+  int level_width = (width + 3) / 4;
+  int level_height = (height + 3) / 4;
+  glGenFramebuffers(2, level_framebuffers);
+  for(int i = 0; i < 2; i++) {
+    glBindFramebuffer(GL_FRAMEBUFFER, level_framebuffers[i]);
+    for(int j = 0; j < 3; j++) {
+      level_textures[i][j] = newFloatTexture(GL_RGBA32F, level_width, level_height);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + j, GL_TEXTURE_2D,
+                             level_textures[i][j], 0);
+    }
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  }
+
+  histogram_texture = newFloatTexture(GL_R32F, std::max(bins, 1), 3 * HISTOGRAM_COPIES);
+  glGenFramebuffers(1, &histogram_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, histogram_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, histogram_texture, 0);
+  complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+  if(!complete) {
+    Rcpp::Rcout << "Reduction framebuffer is incomplete\n";
+    destroy();
+    return(false);
+  }
+  return(true);
+}
+
+void ReducePass::destroy() {
+  if(!reduce_program) {
+    return;
+  }
+  glDeleteProgram(reduce_program);
+  glDeleteProgram(histogram_program);
+  glDeleteVertexArrays(1, &vertex_array);
+  glDeleteFramebuffers(1, &source_framebuffer);
+  glDeleteTextures(1, &source_texture);
+  glDeleteFramebuffers(2, level_framebuffers);
+  glDeleteTextures(3, level_textures[0]);
+  glDeleteTextures(3, level_textures[1]);
+  glDeleteFramebuffers(1, &histogram_framebuffer);
+  glDeleteTextures(1, &histogram_texture);
+  reduce_program = 0;
+  histogram_program = 0;
+  width = 0;
+  height = 0;
+  bins = 0;
+}
+
+void ReducePass::reduce(GLuint source, float hist_min, float hist_max, FrameStats& stats) {
+  static const GLenum draw_buffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+                                         GL_COLOR_ATTACHMENT2};
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, source_framebuffer);
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  GLint previous_vertex_array = 0;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vertex_array);
+  glBindVertexArray(vertex_array);
+
+  glUseProgram(reduce_program);
+  for(int j = 0; j < 3; j++) {
+    glUniform1i(input_locations[j], j);
+  }
+  GLuint inputs[3] = {source_texture, source_texture, source_texture};
+  int level_width = width;
+  int level_height = height;
+  int level = 0;
+  do {
+    glUniform2i(size_location, level_width, level_height);
+    for(int j = 0; j < 3; j++) {
+      glActiveTexture(GL_TEXTURE0 + j);
+      glBindTexture(GL_TEXTURE_2D, inputs[j]);
+    }
+    level_width = (level_width + 3) / 4;
+    level_height = (level_height + 3) / 4;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, level_framebuffers[level]);
+    glDrawBuffers(3, draw_buffers);
+    glViewport(0, 0, level_width, level_height);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    for(int j = 0; j < 3; j++) {
+      inputs[j] = level_textures[level][j];
+    }
+    level = 1 - level;
+  } while(level_width * level_height > REDUCE_CPU_TEXELS);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, level_framebuffers[1 - level]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  size_t texels = (size_t)level_width * level_height;
+  std::vector<float> partials(texels * 4);
+  for(int j = 0; j < 3; j++) {
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + j);
+    glReadPixels(0, 0, level_width, level_height, GL_RGBA, GL_FLOAT, partials.data());
+    for(int c = 0; c < 3; c++) {
+      double value = j == 2 ? 0 : partials[c];
+      for(size_t i = 0; i < texels; i++) {
+        double partial = partials[i * 4 + c];
+        if(j == 0) {
+          value = std::min(value, partial);
+        } else if(j == 1) {
+          value = std::max(value, partial);
+        } else {
+          value += partial;
+        }
+      }
+      (j == 0 ? stats.min : j == 1 ? stats.max : stats.sum)[c] = value;
+    }
+  }
+
+  stats.histogram.clear();
+  if(bins > 0) {
+    glBindFramebuffer(GL_FRAMEBUFFER, histogram_framebuffer);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, bins, 3 * HISTOGRAM_COPIES);
+    const GLfloat zero[4] = {0, 0, 0, 0};
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glUseProgram(histogram_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source_texture);
+    glUniform1i(frame_location, 0);
+    glUniform1i(frame_width_location, width);
+    glUniform2f(range_location, hist_min, hist_max);
+    glUniform1i(bins_location, bins);
+    glUniform1i(copies_location, HISTOGRAM_COPIES);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDrawArraysInstanced(GL_POINTS, 0, width * height, 3);
+    glDisable(GL_BLEND);
+    std::vector<float> counts((size_t)bins * 3 * HISTOGRAM_COPIES);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, bins, 3 * HISTOGRAM_COPIES, GL_RED, GL_FLOAT, counts.data());
+    stats.histogram.assign((size_t)bins * 3, 0);
+    for(size_t row = 0; row < (size_t)3 * HISTOGRAM_COPIES; row++) {
+      double* channel = &stats.histogram[row / HISTOGRAM_COPIES * bins];
+      for(int b = 0; b < bins; b++) {
+        channel[b] += counts[row * bins + b];
+      }
+    }
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(previous_vertex_array);
+}
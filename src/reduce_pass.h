@@ -0,0 +1,60 @@
+#ifndef REDUCEPASSH
+#define REDUCEPASSH
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+//Per-channel (RGB) summary of one frame. `histogram` holds `bins` counts for
+//red, then green, then blue.
+struct FrameStats {
+  double min[3];
+  double max[3];
+  double sum[3];
+  std::vector<double> histogram;
+};
+
+//Summarises a float frame on the GPU so only a few numbers are read back.
+//Min, max, and sum are reduced by ping-ponging between two sets of targets,
+//each pass folding 4x4 blocks into one texel, until few enough texels are
+//left to finish on the CPU in double precision.
+//The histogram draws one point per pixel and channel into a float target with
+//additive blending, so each texel counts the values in its bin.
+class ReducePass {
+public:
+  ReducePass() : width(0), height(0), bins(0), reduce_program(0), histogram_program(0) {}
+  //(Re)creates the pass for width x height frames and `bins` histogram bins
+  bool create(int width, int height, int bins, bool verbose);
+  void destroy();
+  //Reduces the float frame in color attachment 0 of `source_framebuffer`.
+  //Values in [hist_min, hist_max] are binned (the last bin is closed); any
+  //outside it, or NaN, are left out of the histogram.
+  void reduce(GLuint source_framebuffer, float hist_min, float hist_max, FrameStats& stats);
+
+  int width;
+  int height;
+  int bins;
+private:
+  GLuint reduce_program;
+  GLuint histogram_program;
+  GLuint vertex_array;
+  GLuint source_framebuffer;
+  GLuint source_texture;
+  //Two sets of min, max, and sum targets
+  GLuint level_framebuffers[2];
+  GLuint level_textures[2][3];
+  GLuint histogram_framebuffer;
+  GLuint histogram_texture;
+  GLint size_location;
+  GLint input_locations[3];
+  GLint frame_location;
+  GLint frame_width_location;
+  GLint range_location;
+  GLint bins_location;
+  GLint copies_location;
+};
+
+#endif
@@ -0,0 +1,493 @@
+#include <Rcpp.h>
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+#include "loadshaders.h"
+#include "context.h"
+#include "render_session.h"
+#include "save_image.h"
+#include "png_stream.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <memory>
+#include <vector>
+
+bool RenderSession::start(int width, int height, int backend, bool verbose) {
+  //Frames always render into an explicitly sized framebuffer object, so the
+  //output size doesn't depend on the display or HiDPI scaling
+  if(!CreateRenderContext(context, width, height, backend, verbose, true)) {
+    return(false);
+  }
+  this->verbose = verbose;
+  if(context.window) {
+    // Hide the mouse and enable unlimited movement
+    // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwPollEvents();
+    // glfwSetCursorPos(window, nx/2, ny/2);
+  }
+  glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
+
+  CreateFullscreenTriangle(triangle);
+  open = true;
+  return(true);
+}
+
+void RenderSession::close() {
+  if(!open) {
+    return;
+  }
+  //A frame callback (or a finalizer run by its allocations) can close a
+  //session in the middle of another one's render, so that render's context
+  //is made current again once this one is gone
+  RenderContext* caller = CurrentRenderContext();
+  MakeRenderContextCurrent(context);
+  programs.clear();
+  yuv_pass.destroy();
+  reduce_pass.destroy();
+  DestroyRenderTarget(float_target);
+  DestroyFullscreenTriangle(triangle);
+  DestroyRenderContext(context);
+  open = false;
+  if(caller && caller != &context) {
+    MakeRenderContextCurrent(*caller);
+  }
+}
+
+//Binds the triangle and the program (built, or reused from the cache) with
+//its transform set; returns 0 if the program failed to build
+GLuint RenderSession::useProgram(const Rcpp::CharacterVector vertex_shader,
+                                 const Rcpp::CharacterVector fragment_shader,
+                                 const std::string& defines) {
+  glBindVertexArray(triangle.vertex_array);
+  GLuint programID = programs.get(vertex_shader, fragment_shader, verbose, defines);
+  glUseProgram(programID);
+  if(programID) {
+    SetFullscreenUniforms(programID);
+  }
+  return(programID);
+}
+
+int RenderSession::renderFrames(const Rcpp::CharacterVector vertex_shader,
+                                const Rcpp::CharacterVector fragment_shader,
+                                int type, const FrameClock& clock, int frames,
+                                const std::string& filestring,
+                                int readback_buffers, int encode_threads,
+                                int png_level, int png_filter, int compress_threads,
+                                FrameStream* stream, int yuv_range,
+                                const std::vector<SweepUniform>* sweep, bool offline) {
+  size_t allocations_at_start = FrameAllocations();
+  //Another session (or run_shader()) may have taken over the thread since the last call
+  MakeRenderContextCurrent(context);
+  if(context.window) {
+    glfwSetWindowShouldClose(context.window, GLFW_FALSE);
+  }
+  // Create and compile our GLSL program from the shaders (or reuse the cached one)
+  GLuint programID = useProgram(vertex_shader, fragment_shader);
+  if(!programID) {
+    Rcpp::Rcout << "Failed to build the shader program\n";
+    return(0);
+  }
+
+  GLuint uTime;
+  if(type == 1) {
+    uTime = glGetUniformLocation(programID, "u_time");
+  } else {
+    uTime = glGetUniformLocation(programID, "iTime");
+  }
+
+  GLuint screenResolution;
+  if(type == 1) {
+    screenResolution = glGetUniformLocation(programID, "u_resolution");
+  } else {
+    screenResolution = glGetUniformLocation(programID, "iResolution");
+  }
+
+  GLuint mousePos;
+  mousePos = glGetUniformLocation(programID, "u_mouse");
+
+  //Sweep uniforms are looked up once; only their values change per frame
+  std::vector<GLint> sweepLocations;
+  if(sweep) {
+    for(size_t i = 0; i < sweep->size(); i++) {
+      GLint location = glGetUniformLocation(programID, (*sweep)[i].name.c_str());
+      if(location < 0 && verbose) {
+        Rcpp::Rcout << "Uniform " << (*sweep)[i].name << " is not used by the shader\n";
+      }
+      sweepLocations.push_back(location);
+    }
+  }
+
+  double xpos = 0, ypos = 0;
+  int frame_width, frame_height;
+  GetRenderSize(context, &frame_width, &frame_height);
+  //The viewport, resolution and (until it moves) mouse are the same for every
+  //frame, so only the time changes per frame
+  glViewport(0, 0, frame_width, frame_height);
+  glUniform2f(screenResolution, frame_width, frame_height);
+  glUniform2f(mousePos, 0, 0);
+  double mouse_x = 0, mouse_y = 0;
+  GLsizei frame_stride = imageStride(frame_width, 3);
+  //PNG compression runs on `encode_threads` workers while this thread renders;
+  //at most two frames per worker wait in the queue.
+  SetPngOptions(png_level, png_filter, compress_threads);
+  EncodeStats stats;
+  std::unique_ptr<EncodePool> encoder;
+  if(encode_threads > 0 && !stream) {
+    encoder.reset(new EncodePool(encode_threads, 2 * encode_threads,
+                                 frame_width, frame_height, frame_stride));
+  } else if(!stream) {
+    arena.png.reserve(frame_width, frame_height);
+  }
+  //With N > 0 buffers, frame k is written while frames k+1..k+N render
+  FrameOutput output(encoder.get(), &stats, stream, &arena, &context);
+  //YUV frames can only be streamed
+  YuvPass* yuv = NULL;
+  if(yuv_range > 0 && stream) {
+    if(!yuv_pass.create(frame_width, frame_height, yuv_range == 2, verbose)) {
+      return(0);
+    }
+    yuv = &yuv_pass;
+  }
+  if(readback_buffers <= 0) {
+    ReserveFrameBuffer(arena.pixels, yuv ? yuv->size() : (size_t)frame_stride * frame_height);
+  }
+  //Frame names are built in place: the prefix, the frame number, ".png"
+  arena.file.reserve(filestring.size() + 32);
+  arena.file.assign(filestring);
+  char countstr[32];
+  size_t allocations_after_first = 0;
+  std::unique_ptr<ReadbackRing> readback;
+  if(readback_buffers > 0) {
+    readback.reset(new ReadbackRing(readback_buffers, output));
+  }
+  
+  int counter = 0;
+  size_t draw_calls = 0;
+  do{
+    size_t calls_before = GLCalls();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if(xpos != mouse_x || ypos != mouse_y) {
+      glUniform2f(mousePos, xpos, ypos);
+      mouse_x = xpos;
+      mouse_y = ypos;
+    }
+    glUniform1f(uTime, (GLfloat)clock.at(counter));
+    for(size_t i = 0; i < sweepLocations.size(); i++) {
+      const SweepUniform& column = (*sweep)[i];
+      if(column.integer) {
+        glUniform1i(sweepLocations[i], (GLint)column.values[counter]);
+      } else {
+        glUniform1f(sweepLocations[i], (GLfloat)column.values[counter]);
+      }
+    }
+    DrawFullscreenTriangle();
+    //The first frame also moves the mouse from its unset position
+    if(counter > 0) {
+      draw_calls += GLCalls() - calls_before;
+    }
+
+    // Swap buffers
+    PresentRenderContext(context);
+    counter++;
+    snprintf(countstr, sizeof(countstr), "%d.png", clock.number(counter - 1));
+    arena.file.resize(filestring.size());
+    arena.file.append(countstr);
+    if(readback) {
+      readback->queue(arena.file, context, yuv);
+    } else {
+      saveImage(arena.file, context, output, yuv);
+    }
+    if(counter == 1) {
+      allocations_after_first = FrameAllocations();
+    }
+    //The encoder behind a stream has gone away
+    if(stream && !stream->ok()) {
+      break;
+    }
+    //Input is only read here, once per frame, and only to stop early or move
+    //u_mouse; it never changes a frame's time
+    if(context.window && !offline) {
+      glfwPollEvents();
+      if(glfwWindowShouldClose(context.window) ||
+         glfwGetKey(context.window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        break;
+      }
+      glfwGetCursorPos(context.window, &xpos, &ypos);
+    }
+  } while(counter < frames);
+  //Write out the frames still in flight
+  readback.reset();
+  if(encoder) {
+    int failed = encoder->finish();
+    if(failed > 0) {
+      Rcpp::Rcout << "Failed to write " << failed << " frame(s)\n";
+    }
+    stats.add(encoder->stats());
+  }
+  frame_allocations = counter > 0 ? FrameAllocations() - allocations_after_first : 0;
+  render_allocations = FrameAllocations() - allocations_at_start;
+  frame_gl_calls = counter > 1 ? (double)draw_calls / (counter - 1) : 0;
+  if(verbose && stats.frames > 0 && stats.seconds > 0) {
+    Rcpp::Rcout << "Encoded " << stats.frames << " frame(s) in " << stats.seconds
+                << "s of encoder time: " << stats.bytes / stats.seconds / 1e6 << " MB/s, "
+                << stats.frames / stats.seconds << " frames/s per thread\n";
+  }
+  return(counter);
+}
+
+//Tiles render at the session's target size, but every one sees the full
+//image's resolution and its own offset added to the fragment coordinate, so
+//the shader works in a single global coordinate space. gl_FragCoord is
+//reserved, so the shader's uses of it are renamed to shadr_FragCoord, which
+//adds the offset.
+static const char* tile_defines =
+  "uniform vec2 shadr_tile_offset;\n"
+  "#define shadr_FragCoord (gl_FragCoord + vec4(shadr_tile_offset, 0.0, 0.0))\n";
+
+static bool isIdentifierChar(char c) {
+  return((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_');
+}
+
+//Replaces the identifier gl_FragCoord (not e.g. my_gl_FragCoord) with
+//shadr_FragCoord
+static std::string tiledFragmentShader(const std::string& code) {
+  static const std::string from = "gl_FragCoord";
+  std::string out;
+  out.reserve(code.size() + 64);
+  size_t start = 0;
+  for(size_t found = code.find(from); found != std::string::npos;
+      found = code.find(from, found + from.size())) {
+    size_t end = found + from.size();
+    if((found > 0 && isIdentifierChar(code[found - 1])) ||
+       (end < code.size() && isIdentifierChar(code[end]))) {
+      continue;
+    }
+    out.append(code, start, found - start);
+    out.append("shadr_FragCoord");
+    start = end;
+  }
+  out.append(code, start, std::string::npos);
+  return(out);
+}
+
+bool RenderSession::renderTiled(const Rcpp::CharacterVector vertex_shader,
+                                const Rcpp::CharacterVector fragment_shader,
+                                int type, float t, int width, int height,
+                                const std::string& file) {
+  MakeRenderContextCurrent(context);
+  if(context.window) {
+    glfwSetWindowShouldClose(context.window, GLFW_FALSE);
+  }
+  Rcpp::CharacterVector tiled_fragment(tiledFragmentShader(Rcpp::as<std::string>(fragment_shader)));
+  GLuint programID = useProgram(vertex_shader, tiled_fragment, tile_defines);
+  if(!programID) {
+    Rcpp::Rcout << "Failed to build the shader program\n";
+    return(false);
+  }
+
+  GLuint uTime = glGetUniformLocation(programID, type == 1 ? "u_time" : "iTime");
+  GLuint screenResolution = glGetUniformLocation(programID, type == 1 ? "u_resolution" : "iResolution");
+  GLuint mousePos = glGetUniformLocation(programID, "u_mouse");
+  GLuint tileOffset = glGetUniformLocation(programID, "shadr_tile_offset");
+
+  glUniform1f(uTime, t);
+  glUniform2f(screenResolution, width, height);
+  glUniform2f(mousePos, 0, 0);
+
+  int tile_width, tile_height;
+  GetRenderSize(context, &tile_width, &tile_height);
+  SetPngOptions(6, -1, 1);
+  PngStream png;
+  if(!png.open(file, width, height)) {
+    return(false);
+  }
+  //One band of tiles is read straight into its columns of a full-width buffer
+  //(GL_PACK_ROW_LENGTH), then handed to the PNG stream top row first
+  std::vector<unsigned char> band((size_t)width * 3 * std::min(tile_height, height));
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ROW_LENGTH, width);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, context.target.framebuffer);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+  //PNG rows run top to bottom, GL rows bottom to top
+  int n_bands = (height + tile_height - 1) / tile_height;
+  bool cancelled = false;
+  for(int b = 0; b < n_bands && !cancelled; b++) {
+    int band_top = height - b * tile_height;
+    int band_y = std::max(0, band_top - tile_height);
+    int band_height = band_top - band_y;
+    for(int x = 0; x < width; x += tile_width) {
+      int tw = std::min(tile_width, width - x);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      glViewport(0, 0, tw, band_height);
+      glUniform2f(tileOffset, x, band_y);
+      DrawFullscreenTriangle();
+      glReadPixels(0, 0, tw, band_height, GL_RGB, GL_UNSIGNED_BYTE, band.data() + (size_t)x * 3);
+      if(context.window) {
+        PresentRenderContext(context);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, context.target.framebuffer);
+        glfwPollEvents();
+        if(glfwWindowShouldClose(context.window) ||
+           glfwGetKey(context.window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+          cancelled = true;
+          break;
+        }
+      }
+    }
+    if(cancelled) {
+      break;
+    }
+    long stride = (long)width * 3;
+    if(!png.writeRows(band.data() + (band_height - 1) * stride, band_height, -stride)) {
+      Rcpp::Rcout << "Failed to write " << file << "\n";
+      break;
+    }
+    if(verbose) {
+      Rcpp::Rcout << "Rendered band " << b + 1 << " of " << n_bands << "\n";
+    }
+  }
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  return(png.close());
+}
+
+//Leaves the float target bound with the frame in it
+bool RenderSession::drawFloat(const Rcpp::CharacterVector vertex_shader,
+                              const Rcpp::CharacterVector fragment_shader,
+                              int type, float t, bool half) {
+  MakeRenderContextCurrent(context);
+  int width, height;
+  GetRenderSize(context, &width, &height);
+  //The float target is kept for the next call at the same size and precision
+  GLenum format = half ? GL_RGBA16F : GL_RGBA32F;
+  if(!float_target.framebuffer || float_target.width != width ||
+     float_target.height != height || float_target.format != format) {
+    DestroyRenderTarget(float_target);
+    if(!CreateRenderTarget(float_target, width, height, true, format)) {
+      MakeRenderContextCurrent(context);
+      return(false);
+    }
+  }
+  BindRenderTarget(float_target);
+  GLuint programID = useProgram(vertex_shader, fragment_shader);
+  if(!programID) {
+    Rcpp::Rcout << "Failed to build the shader program\n";
+    MakeRenderContextCurrent(context);
+    return(false);
+  }
+
+  GLuint uTime = glGetUniformLocation(programID, type == 1 ? "u_time" : "iTime");
+  GLuint screenResolution = glGetUniformLocation(programID, type == 1 ? "u_resolution" : "iResolution");
+  GLuint mousePos = glGetUniformLocation(programID, "u_mouse");
+
+  glUniform1f(uTime, t);
+  glUniform2f(screenResolution, width, height);
+  glUniform2f(mousePos, 0, 0);
+
+  glViewport(0, 0, width, height);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  DrawFullscreenTriangle();
+  return(true);
+}
+
+bool RenderSession::renderFloat(const Rcpp::CharacterVector vertex_shader,
+                                const Rcpp::CharacterVector fragment_shader,
+                                int type, float t, bool half, std::vector<float>& pixels) {
+  if(!drawFloat(vertex_shader, fragment_shader, type, t, half)) {
+    return(false);
+  }
+  int width = float_target.width;
+  int height = float_target.height;
+  pixels.resize((size_t)width * height * 3);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_FLOAT, pixels.data());
+  BindRenderTarget(context.target);
+  return(true);
+}
+
+bool RenderSession::renderStats(const Rcpp::CharacterVector vertex_shader,
+                                const Rcpp::CharacterVector fragment_shader,
+                                int type, float t, bool half, int bins,
+                                float hist_min, float hist_max, FrameStats& stats) {
+  if(!drawFloat(vertex_shader, fragment_shader, type, t, half)) {
+    return(false);
+  }
+  if(!reduce_pass.create(float_target.width, float_target.height, bins, verbose)) {
+    BindRenderTarget(context.target);
+    return(false);
+  }
+  reduce_pass.reduce(float_target.framebuffer, hist_min, hist_max, stats);
+  BindRenderTarget(context.target);
+  return(true);
+}
+
+bool RenderSession::evaluateGrid(const Rcpp::CharacterVector vertex_shader,
+                                 const Rcpp::CharacterVector fragment_shader,
+                                 const std::vector<std::vector<float> >& inputs,
+                                 int nrow, int ncol, std::vector<float>& output) {
+  MakeRenderContextCurrent(context);
+  if(!float_target.framebuffer || float_target.width != nrow ||
+     float_target.height != ncol || float_target.format != GL_R32F) {
+    DestroyRenderTarget(float_target);
+    if(!CreateRenderTarget(float_target, nrow, ncol, false, GL_R32F)) {
+      MakeRenderContextCurrent(context);
+      return(false);
+    }
+  }
+  GLuint programID = useProgram(vertex_shader, fragment_shader);
+  if(!programID) {
+    MakeRenderContextCurrent(context);
+    return(false);
+  }
+
+  std::vector<GLuint> textures(inputs.size());
+  glGenTextures((GLsizei)textures.size(), textures.data());
+  for(size_t i = 0; i < inputs.size(); i++) {
+    glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, nrow, ncol, 0, GL_RED, GL_FLOAT, inputs[i].data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    std::string sampler = "shadr_input_" + std::to_string(i + 1);
+    glUniform1i(glGetUniformLocation(programID, sampler.c_str()), (GLint)i);
+  }
+
+  BindRenderTarget(float_target);
+  glViewport(0, 0, nrow, ncol);
+  glClear(GL_COLOR_BUFFER_BIT);
+  DrawFullscreenTriangle();
+
+  output.resize((size_t)nrow * ncol);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, nrow, ncol, GL_RED, GL_FLOAT, output.data());
+
+  glDeleteTextures((GLsizei)textures.size(), textures.data());
+  glActiveTexture(GL_TEXTURE0);
+  BindRenderTarget(context.target);
+  return(true);
+}
+
+std::string RenderSession::gridLimitError(int n_inputs, int nrow, int ncol) {
+  MakeRenderContextCurrent(context);
+  GLint max_units = 0, max_texture = 0, max_renderbuffer = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture);
+  glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer);
+  if(n_inputs > max_units) {
+    return("The grid has " + std::to_string(n_inputs) + " inputs, but this driver can only bind " +
+           std::to_string(max_units) + " textures to a fragment shader.");
+  }
+  GLint max_size = std::min(max_texture, max_renderbuffer);
+  if(nrow > max_size || ncol > max_size) {
+    return("The grid is " + std::to_string(nrow) + " x " + std::to_string(ncol) +
+           ", but this driver's textures and renderbuffers are limited to " +
+           std::to_string(max_size) + " x " + std::to_string(max_size) + ".");
+  }
+  return(std::string());
+}
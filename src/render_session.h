@@ -0,0 +1,139 @@
+#ifndef RENDERSESSIONH
+#define RENDERSESSIONH
+
+#include <Rcpp.h>
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+
+#include "context.h"
+#include "loadshaders.h"
+#include "frame_stream.h"
+#include "yuv_pass.h"
+#include "reduce_pass.h"
+#include "encode_pool.h"
+#include "fullscreen.h"
+#include <string>
+#include <vector>
+
+//One column of a parameter sweep: frame i sets the uniform `name` to row i
+//of `values` (with glUniform1i for integer columns)
+struct SweepUniform {
+  std::string name;
+  bool integer;
+  std::vector<double> values;
+};
+
+//Simulated time frames are rendered at, independent of the wall clock and of
+//any input: frame i (from 0) is at start + i * step, or at times[i] when
+//`times` is given. Each time is computed in double rather than accumulated,
+//so long movies don't drift. Frames are numbered i + 1 in file names and
+//callbacks, or numbers[i] when `numbers` is given, so a subset of a longer
+//animation keeps the numbers it would have had in the whole thing.
+struct FrameClock {
+  FrameClock(double start = 0, double step = 0) : start(start), step(step) {}
+  double at(int i) const { return(times.empty() ? start + i * step : times[i]); }
+  int number(int i) const { return(numbers.empty() ? i + 1 : numbers[i]); }
+  double start;
+  double step;
+  std::vector<double> times;
+  std::vector<int> numbers;
+};
+
+//Everything that is expensive to set up once per render: the GL context, the
+//fullscreen triangle and every program linked so far. One-shot calls open and
+//close a session around a single render; R can also hold one open (as an
+//external pointer) and render many frames and shaders through it.
+class RenderSession {
+public:
+  RenderSession(size_t cache_size = 32) : programs(cache_size), frame_allocations(0),
+    render_allocations(0), frame_gl_calls(0), open(false), float_target() {}
+  ~RenderSession() { close(); }
+
+  bool start(int width, int height, int backend, bool verbose);
+  void close();
+  bool isOpen() const { return open; }
+  //Renders `frames` frames at the times `clock` gives them, writing
+  //`<filestring><n>.png` with n the clock's number for each frame.
+  //`png_level` is the zlib level (0-9) and `png_filter` the PNG filter forced
+  //on every row (0-4), or -1 to pick the best one per row. Each frame is
+  //deflated on up to `compress_threads` threads. With a `stream`, raw frames
+  //go to it in order instead and no files are written; `yuv_range` 1
+  //(limited) or 2 (full) converts them to YUV 4:2:0 on the GPU first. With a
+  //`sweep`, frame i also sets every sweep uniform to its value in row i. A
+  //window is polled once per frame, so ESC or closing it stops the render,
+  //unless `offline`, in which case nothing reads input while rendering.
+  int renderFrames(const Rcpp::CharacterVector vertex_shader,
+                   const Rcpp::CharacterVector fragment_shader,
+                   int type, const FrameClock& clock, int frames, const std::string& filestring,
+                   int readback_buffers, int encode_threads,
+                   int png_level = 6, int png_filter = -1, int compress_threads = 1,
+                   FrameStream* stream = NULL, int yuv_range = 0,
+                   const std::vector<SweepUniform>* sweep = NULL, bool offline = false);
+  //Renders one width x height image at time `t` in tiles of the session's
+  //size (so it can exceed the driver's viewport and renderbuffer limits) and
+  //streams it to the PNG `file` one row of tiles at a time
+  bool renderTiled(const Rcpp::CharacterVector vertex_shader,
+                   const Rcpp::CharacterVector fragment_shader,
+                   int type, float t, int width, int height, const std::string& file);
+  //Renders one frame at time `t` into a 32-bit (or, with `half`, 16-bit) float
+  //target of the session's size and reads it back unquantized and unclamped
+  //into `pixels` as bottom-up RGB
+  bool renderFloat(const Rcpp::CharacterVector vertex_shader,
+                   const Rcpp::CharacterVector fragment_shader,
+                   int type, float t, bool half, std::vector<float>& pixels);
+  //Renders one float frame like renderFloat() and reduces it on the GPU to
+  //per-channel min, max, and sum plus a `bins`-bin histogram over
+  //[hist_min, hist_max], so only those numbers are read back
+  bool renderStats(const Rcpp::CharacterVector vertex_shader,
+                   const Rcpp::CharacterVector fragment_shader,
+                   int type, float t, bool half, int bins,
+                   float hist_min, float hist_max, FrameStats& stats);
+  //Runs `fragment_shader` once per cell of an nrow x ncol grid into a 32-bit
+  //float target and reads back its red channel. Input i is bound as a
+  //single-channel float texture to the sampler `shadr_input_<i>` (from 1).
+  //Inputs and output are column-major, so cell (i, j) is texel (i, j).
+  bool evaluateGrid(const Rcpp::CharacterVector vertex_shader,
+                    const Rcpp::CharacterVector fragment_shader,
+                    const std::vector<std::vector<float> >& inputs,
+                    int nrow, int ncol, std::vector<float>& output);
+  //Why evaluateGrid() can't run an nrow x ncol grid with `n_inputs` input
+  //textures on this context's driver (too many inputs for its texture units,
+  //or a grid past its texture or renderbuffer size), or "" if it can
+  std::string gridLimitError(int n_inputs, int nrow, int ncol);
+
+  RenderContext context;
+  ProgramCache programs;
+  //Frame path allocations (see FrameAllocations()) after the first frame of
+  //the last renderFrames() call; 0 once the buffers are warm
+  size_t frame_allocations;
+  //The same over the whole of the last renderFrames() call, setup included;
+  //0 once a render with the same settings has sized the session's buffers
+  size_t render_allocations;
+  //GL calls (see GLCalls()) each frame after the first of the last
+  //renderFrames() call made to draw, on average: the time uniform, plus any
+  //sweep uniforms and mouse moves
+  double frame_gl_calls;
+private:
+  bool open;
+  bool verbose;
+  FullscreenTriangle triangle;
+  YuvPass yuv_pass;
+  ReducePass reduce_pass;
+  RenderTarget float_target;
+  FrameArena arena;
+
+  GLuint useProgram(const Rcpp::CharacterVector vertex_shader,
+                    const Rcpp::CharacterVector fragment_shader,
+                    const std::string& defines = std::string());
+  bool drawFloat(const Rcpp::CharacterVector vertex_shader,
+                 const Rcpp::CharacterVector fragment_shader,
+                 int type, float t, bool half);
+};
+
+//The open session behind an R external pointer; stops if it has been closed
+RenderSession* getSession(SEXP session);
+
+#endif
@@ -0,0 +1,93 @@
+#include <Rcpp.h>
+
+#include "render_target.h"
+#include <algorithm>
+
+bool CreateRenderTarget(RenderTarget& target, int width, int height, bool depth,
+                        GLenum format) {
+  target.width = width;
+  target.height = height;
+  target.format = format;
+  target.framebuffer = 0;
+  target.colorbuffer = 0;
+  target.depthbuffer = 0;
+
+  GLint max_renderbuffer = 0;
+  GLint max_viewport[2] = {0, 0};
+  glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer);
+  glGetIntegerv(GL_MAX_VIEWPORT_DIMS, max_viewport);
+  if(width > max_renderbuffer || height > max_renderbuffer ||
+     width > max_viewport[0] || height > max_viewport[1]) {
+    Rcpp::Rcout << "Requested size " << width << "x" << height << " exceeds the driver's limit of "
+                << std::min(max_renderbuffer, max_viewport[0]) << "x"
+                << std::min(max_renderbuffer, max_viewport[1]) << "\n";
+    return(false);
+  }
+
+  glGenFramebuffers(1, &target.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+
+  glGenRenderbuffers(1, &target.colorbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, target.colorbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorbuffer);
+
+  if(depth) {
+    glGenRenderbuffers(1, &target.depthbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthbuffer);
+  }
+
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    Rcpp::Rcout << "Offscreen framebuffer is incomplete\n";
+    DestroyRenderTarget(target);
+    return(false);
+  }
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  return(true);
+}
+
+void DestroyRenderTarget(RenderTarget& target) {
+  if(target.framebuffer) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &target.framebuffer);
+    target.framebuffer = 0;
+  }
+  if(target.colorbuffer) {
+    glDeleteRenderbuffers(1, &target.colorbuffer);
+    target.colorbuffer = 0;
+  }
+  if(target.depthbuffer) {
+    glDeleteRenderbuffers(1, &target.depthbuffer);
+    target.depthbuffer = 0;
+  }
+}
+
+void BindRenderTarget(const RenderTarget& target) {
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+void BlitRenderTarget(const RenderTarget& target, GLFWwindow* window) {
+  int window_width, window_height;
+  glfwGetFramebufferSize(window, &window_width, &window_height);
+  double scale = std::min((double)window_width / target.width,
+                          (double)window_height / target.height);
+  int preview_width  = (int)(target.width * scale);
+  int preview_height = (int)(target.height * scale);
+  int x0 = (window_width - preview_width) / 2;
+  int y0 = (window_height - preview_height) / 2;
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glDrawBuffer(GL_BACK);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+  glBlitFramebuffer(0, 0, target.width, target.height,
+                    x0, y0, x0 + preview_width, y0 + preview_height,
+                    GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  glfwSwapBuffers(window);
+  BindRenderTarget(target);
+}
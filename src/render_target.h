@@ -0,0 +1,30 @@
+#ifndef RENDERTARGETH
+#define RENDERTARGETH
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+
+//Explicitly sized framebuffer object that frames are rendered into and read
+//back from, independent of any window (and of HiDPI scaling).
+struct RenderTarget {
+  int width;
+  int height;
+  GLuint framebuffer;
+  GLuint colorbuffer;
+  GLuint depthbuffer;
+  GLenum format;
+};
+
+//Leaves the new target bound; `depth` adds a 24-bit depth attachment.
+//`format` is the color attachment's internal format, e.g. GL_RGBA32F for
+//unquantized float output.
+bool CreateRenderTarget(RenderTarget& target, int width, int height, bool depth,
+                        GLenum format = GL_RGBA8);
+void DestroyRenderTarget(RenderTarget& target);
+void BindRenderTarget(const RenderTarget& target);
+//Scales the target into `window`, letterboxed to keep its aspect ratio
+void BlitRenderTarget(const RenderTarget& target, GLFWwindow* window);
+
+#endif
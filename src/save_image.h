@@ -3,20 +3,200 @@
 //GLWF3 Installed with cmake, make install 
 #include <GLFW/glfw3.h>
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include "context.h"
+#include "encode_pool.h"
+#include "frame_alloc.h"
+#include "frame_stream.h"
+#include "yuv_pass.h"
 
-void saveImage(const char* file, GLFWwindow* window) {
-  int width, height;
-  glfwGetFramebufferSize(window, &width, &height);
-  GLsizei n_channels = 3;
+#include <string>
+#include <vector>
+
+static GLsizei imageStride(int width, GLsizei n_channels) {
   GLsizei stride = n_channels * width;
   stride += (stride % 4) ? (4 - stride % 4) : 0;
-  GLsizei buffer_size = stride * height;
-  std::vector<char> buffer(buffer_size);
+  return(stride);
+}
+
+static void readFramebuffer(RenderContext& context, int width, int height, void* pixels) {
   glPixelStorei(GL_PACK_ALIGNMENT, 4);
-  glReadBuffer(GL_FRONT);
-  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, buffer.data());
-  stbi_flip_vertically_on_write(true);
-  stbi_write_png(file, width, height, n_channels, buffer.data(), stride);
-}
\ No newline at end of file
+  BindPresentedFrame(context);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+}
+
+//Where read-back frames go: raw into `stream` if there is one, otherwise to
+//PNG files compressed on `pool`'s workers or on this thread (timed in `stats`).
+//Frames read back and encoded on this thread use the `arena`'s buffers.
+//`context` is made current again after a stream that runs R code.
+struct FrameOutput {
+  FrameOutput(EncodePool* pool = NULL, EncodeStats* stats = NULL, FrameStream* stream = NULL,
+              FrameArena* arena = NULL, RenderContext* context = NULL) :
+    pool(pool), stats(stats), stream(stream), arena(arena), context(context) {}
+  EncodePool* pool;
+  EncodeStats* stats;
+  FrameStream* stream;
+  FrameArena* arena;
+  RenderContext* context;
+};
+
+static void resumeRenderContext(const FrameOutput& output) {
+  if(output.context && output.stream->runsR()) {
+    MakeRenderContextCurrent(*output.context);
+  }
+}
+
+static void writeImage(const std::string& file, int width, int height, int stride,
+                       const unsigned char* pixels, const FrameOutput& output) {
+  if(output.stream) {
+    output.stream->write(pixels, width, height, stride);
+    resumeRenderContext(output);
+  } else if(output.pool) {
+    output.pool->submit(file, width, height, stride, pixels);
+  } else {
+    EncodeStats unused;
+    if(output.arena) {
+      EncodePng(file, width, height, stride, pixels, output.stats ? *output.stats : unused,
+                output.arena->png);
+    } else {
+      PngScratch scratch;
+      EncodePng(file, width, height, stride, pixels, output.stats ? *output.stats : unused,
+                scratch);
+    }
+  }
+}
+
+//YUV frames can only go to a stream
+static void writeYuvFrame(const unsigned char* planes, int width, int height, bool full_range,
+                          const FrameOutput& output) {
+  if(output.stream) {
+    output.stream->writeYuv(planes, width, height, full_range);
+    resumeRenderContext(output);
+  }
+}
+
+//With `yuv`, the frame is converted on the GPU and read back as YUV 4:2:0.
+//Pixels are read into the output's arena, when it has one.
+void saveImage(const std::string& file, RenderContext& context,
+               const FrameOutput& output = FrameOutput(), YuvPass* yuv = NULL) {
+  std::vector<unsigned char> local;
+  std::vector<unsigned char>& buffer = output.arena ? output.arena->pixels : local;
+  if(yuv) {
+    yuv->convert(context);
+    unsigned char* planes = ReserveFrameBuffer(buffer, yuv->size());
+    yuv->read(planes);
+    writeYuvFrame(planes, yuv->width, yuv->height, yuv->full_range, output);
+    return;
+  }
+  int width, height;
+  GetRenderSize(context, &width, &height);
+  GLsizei n_channels = 3;
+  GLsizei stride = imageStride(width, n_channels);
+  GLsizei buffer_size = stride * height;
+  unsigned char* pixels = ReserveFrameBuffer(buffer, buffer_size);
+  readFramebuffer(context, width, height, pixels);
+  writeImage(file, width, height, stride, pixels, output);
+}
+
+//Ring of pixel pack buffers: glReadPixels into a PBO returns immediately, and
+//the frame is only mapped and written once `n_buffers` newer frames have been
+//queued behind it, so the GPU never has to drain before the next frame starts.
+//Frames are always written in the order they were queued.
+class ReadbackRing {
+public:
+  ReadbackRing(int n_buffers, const FrameOutput& output = FrameOutput()) :
+    slots(n_buffers), oldest(0), in_flight(0), output(output) {
+    for(size_t i = 0; i < slots.size(); i++) {
+      glGenBuffers(1, &slots[i].pbo);
+      slots[i].fence = 0;
+      slots[i].size = 0;
+      slots[i].file.reserve(256);
+    }
+  }
+  ~ReadbackRing() {
+    flush();
+    for(size_t i = 0; i < slots.size(); i++) {
+      glDeleteBuffers(1, &slots[i].pbo);
+    }
+  }
+  void queue(const std::string& file, RenderContext& context, YuvPass* yuv = NULL) {
+    if(in_flight == slots.size()) {
+      writeOldest();
+    }
+    Slot& slot = slots[(oldest + in_flight) % slots.size()];
+    GLsizeiptr size;
+    if(yuv) {
+      yuv->convert(context);
+      slot.width = yuv->width;
+      slot.height = yuv->height;
+      slot.stride = yuv->width;
+      size = (GLsizeiptr)yuv->size();
+    } else {
+      GetRenderSize(context, &slot.width, &slot.height);
+      slot.stride = imageStride(slot.width, 3);
+      size = (GLsizeiptr)slot.stride * slot.height;
+    }
+    slot.yuv = yuv != NULL;
+    slot.full_range = yuv && yuv->full_range;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if(size != slot.size) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+      slot.size = size;
+    }
+    if(yuv) {
+      yuv->read((void*)0);
+    } else {
+      readFramebuffer(context, slot.width, slot.height, (void*)0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if(slot.file.capacity() < file.size()) {
+      CountFrameAllocation();
+    }
+    slot.file.assign(file);
+    in_flight++;
+  }
+  void flush() {
+    while(in_flight > 0) {
+      writeOldest();
+    }
+  }
+private:
+  struct Slot {
+    GLuint pbo;
+    GLsync fence;
+    GLsizeiptr size;
+    int width, height, stride;
+    bool yuv, full_range;
+    std::string file;
+  };
+  std::vector<Slot> slots;
+  size_t oldest;
+  size_t in_flight;
+  FrameOutput output;
+
+  void writeOldest() {
+    Slot& slot = slots[oldest];
+    //The first wait flushes so the fence is guaranteed to signal
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    while(status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(slot.fence, 0, 1000000000);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+    if(pixels) {
+      if(slot.yuv) {
+        writeYuvFrame((const unsigned char*)pixels, slot.width, slot.height, slot.full_range,
+                      output);
+      } else {
+        writeImage(slot.file, slot.width, slot.height, slot.stride,
+                   (const unsigned char*)pixels, output);
+      }
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    oldest = (oldest + 1) % slots.size();
+    in_flight--;
+  }
+};
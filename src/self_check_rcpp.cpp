@@ -0,0 +1,104 @@
+#include <Rcpp.h>
+using namespace Rcpp;
+
+#include "checksum.h"
+#include "png_filter.h"
+#include <zlib.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+//Compiled checks of the SIMD kernels against their references, run by the
+//package tests. Each returns one row per kernel with the number of cases
+//checked and how many of them differed.
+
+//Every CRC-32 and Adler-32 kernel against zlib's crc32()/adler32(): every
+//length from 0 to `max_length` at every start offset from 0 to 15 (so loads
+//are unaligned), continuing from a random seed, and the same data checksummed
+//in randomly sized chained pieces
+// [[Rcpp::export]]
+DataFrame checksum_check_rcpp(int max_length) {
+  std::mt19937 random(42);
+  std::vector<unsigned char> data(max_length + 16);
+  for(size_t i = 0; i < data.size(); i++) {
+    data[i] = (unsigned char)random();
+  }
+  std::vector<ChecksumKernel> kernels[2] = {Crc32Kernels(), Adler32Kernels()};
+  std::vector<std::string> checksum, kernel;
+  std::vector<int> checked, mismatches;
+  for(int which = 0; which < 2; which++) {
+    for(size_t k = 0; k < kernels[which].size(); k++) {
+      ChecksumFunction function = kernels[which][k].function;
+      int n_checked = 0, n_mismatches = 0;
+      for(int length = 0; length <= max_length; length++) {
+        for(int offset = 0; offset < 16; offset++) {
+          const unsigned char* p = data.data() + offset;
+          unsigned long seed = which == 0 ? (unsigned long)random() : (random() % 65521) | ((random() % 65521) << 16);
+          unsigned long expected = which == 0 ? crc32(seed, p, length) : adler32(seed, p, length);
+          n_checked++;
+          n_mismatches += function((unsigned int)seed, p, length) != (unsigned int)expected;
+          //The same bytes in pieces, each continuing from the last
+          unsigned int chained = which == 0 ? 0 : 1;
+          for(int done = 0; done < length; ) {
+            int piece = std::min(length - done, (int)(random() % 300));
+            chained = function(chained, p + done, piece);
+            done += piece;
+          }
+          expected = which == 0 ? crc32(0, p, length) : adler32(1, p, length);
+          n_checked++;
+          n_mismatches += chained != (unsigned int)expected;
+        }
+      }
+      checksum.push_back(which == 0 ? "crc32" : "adler32");
+      kernel.push_back(kernels[which][k].name);
+      checked.push_back(n_checked);
+      mismatches.push_back(n_mismatches);
+    }
+  }
+  return(DataFrame::create(Named("checksum") = checksum, Named("kernel") = kernel,
+                           Named("checked") = checked, Named("mismatches") = mismatches,
+                           Named("stringsAsFactors") = false));
+}
+
+//Every PNG row filter kernel against the scalar one: each filter mode (and -1,
+//adaptive) for every width from 1 to `max_width` pixels, on random rows and on
+//rows of runs (so adaptive choices tie), with the filter byte and every
+//filtered byte compared
+// [[Rcpp::export]]
+DataFrame png_filter_check_rcpp(int max_width) {
+  std::mt19937 random(7);
+  std::vector<FilterKernel> kernels = PngFilterKernels();
+  std::vector<std::string> kernel;
+  std::vector<int> checked, mismatches;
+  size_t max_bytes = (size_t)max_width * 3;
+  std::vector<unsigned char> row(max_bytes + 1), prev(max_bytes + 1);
+  std::vector<unsigned char> expected(max_bytes + 1), out(max_bytes + 1);
+  for(size_t k = 1; k < kernels.size(); k++) {
+    int n_checked = 0, n_mismatches = 0;
+    for(int width = 1; width <= max_width; width++) {
+      int n_bytes = width * 3;
+      for(int pattern = 0; pattern < 2; pattern++) {
+        for(int i = 0; i < n_bytes; i++) {
+          row[i] = (unsigned char)(pattern == 0 ? random() : (i / 7) * 13);
+          prev[i] = (unsigned char)(pattern == 0 ? random() : (i / 5) * 29);
+        }
+        for(int filter = -1; filter <= 4; filter++) {
+          int expected_filter = FilterPngRowScalar(row.data(), prev.data(), n_bytes, filter,
+                                                   expected.data());
+          int filter_used = kernels[k].function(row.data(), prev.data(), n_bytes, filter,
+                                                out.data());
+          n_checked++;
+          n_mismatches += filter_used != expected_filter ||
+            !std::equal(expected.begin(), expected.begin() + n_bytes + 1, out.begin());
+        }
+      }
+    }
+    kernel.push_back(kernels[k].name);
+    checked.push_back(n_checked);
+    mismatches.push_back(n_mismatches);
+  }
+  return(DataFrame::create(Named("kernel") = kernel, Named("checked") = checked,
+                           Named("mismatches") = mismatches,
+                           Named("stringsAsFactors") = false));
+}
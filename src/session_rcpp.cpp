@@ -0,0 +1,206 @@
+#include <Rcpp.h>
+using namespace Rcpp;
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+#include "render_session.h"
+#include "hdr_image.h"
+#include <memory>
+#include <string>
+
+RenderSession* getSession(SEXP session) {
+  XPtr<RenderSession> ptr(session);
+  if(ptr.get() == NULL || !ptr->isOpen()) {
+    Rcpp::stop("shadr session has been closed.");
+  }
+  return(ptr.get());
+}
+
+// [[Rcpp::export]]
+SEXP open_session_rcpp(int width, int height, int backend, bool verbose, int cache_size) {
+  if(cache_size < 0) {
+    Rcpp::stop("cache_size must be 0 or more.");
+  }
+  RenderSession* session = new RenderSession(cache_size);
+  if(!session->start(width, height, backend, verbose)) {
+    delete session;
+    Rcpp::stop("Failed to create an OpenGL context for the session.");
+  }
+  //The finalizer closes the context if R collects a session that was never closed
+  XPtr<RenderSession> ptr(session, true);
+  return(ptr);
+}
+
+// [[Rcpp::export]]
+SEXP render_session_rcpp(SEXP session, const CharacterVector vertex_shader,
+                        const CharacterVector fragment_shader, int type,
+                        double start, double step, int frames, NumericVector times,
+                        IntegerVector numbers,
+                        CharacterVector filename,
+                        int readback_buffers, int encode_threads,
+                        int png_level, int png_filter, int compress_threads,
+                        CharacterVector pipe_command, SEXP callback, double framerate,
+                        int yuv_range, int array_type, bool offline) {
+  std::string filestring = Rcpp::as<std::string>(filename);
+  RenderSession* render_session = getSession(session);
+  FrameClock clock(start, step);
+  clock.times.assign(times.begin(), times.end());
+  if(!clock.times.empty()) {
+    frames = (int)clock.times.size();
+  }
+  if(numbers.size() > 0) {
+    if((int)numbers.size() != frames) {
+      Rcpp::stop("Expected one frame number per frame.");
+    }
+    clock.numbers.assign(numbers.begin(), numbers.end());
+  }
+  int width, height;
+  GetRenderSize(render_session->context, &width, &height);
+  std::unique_ptr<FrameStream> stream(NewFrameStream(Rcpp::as<std::string>(pipe_command),
+                                                     callback, framerate, array_type,
+                                                     width, height, frames,
+                                                     clock.numbers));
+  int rendered = render_session->renderFrames(vertex_shader, fragment_shader, type, clock, frames,
+                                              filestring, readback_buffers, encode_threads,
+                                              png_level, png_filter, compress_threads,
+                                              stream.get(), yuv_range, NULL, offline);
+  if(rendered == 0) {
+    Rcpp::stop("Failed to build the shader program.");
+  }
+  if(stream) {
+    if(!stream->close()) {
+      Rcpp::stop(stream->error);
+    }
+    if(stream->result() != R_NilValue) {
+      return(stream->result());
+    }
+  }
+  return(wrap(rendered));
+}
+
+// [[Rcpp::export]]
+bool render_tiled_rcpp(SEXP session, const CharacterVector vertex_shader,
+                       const CharacterVector fragment_shader, int type,
+                       float time, int width, int height, CharacterVector filename) {
+  std::string filestring = Rcpp::as<std::string>(filename);
+  return(getSession(session)->renderTiled(vertex_shader, fragment_shader, type, time,
+                                          width, height, filestring));
+}
+
+// [[Rcpp::export]]
+SEXP render_float_rcpp(SEXP session, const CharacterVector vertex_shader,
+                       const CharacterVector fragment_shader, int type,
+                       float time, bool half, CharacterVector filename) {
+  RenderSession* render_session = getSession(session);
+  std::vector<float> pixels;
+  if(!render_session->renderFloat(vertex_shader, fragment_shader, type, time, half, pixels)) {
+    Rcpp::stop("Failed to create a float framebuffer.");
+  }
+  int width, height;
+  GetRenderSize(render_session->context, &width, &height);
+  std::string filestring = Rcpp::as<std::string>(filename);
+  if(!filestring.empty()) {
+    if(!WriteHdr(filestring, width, height, pixels.data())) {
+      Rcpp::stop("Failed to write " + filestring);
+    }
+    return(R_NilValue);
+  }
+  NumericVector image(Rcpp::no_init((R_xlen_t)width * height * 3));
+  CopyFrameToR(pixels.data(), width, height, (size_t)width * 3, image.begin(),
+               [](float v) { return((double)v); });
+  image.attr("dim") = IntegerVector::create(height, width, 3);
+  return(image);
+}
+
+// [[Rcpp::export]]
+List render_stats_rcpp(SEXP session, const CharacterVector vertex_shader,
+                       const CharacterVector fragment_shader, int type,
+                       float time, bool half, int bins, float hist_min, float hist_max) {
+  RenderSession* render_session = getSession(session);
+  FrameStats stats;
+  if(!render_session->renderStats(vertex_shader, fragment_shader, type, time, half,
+                                  bins, hist_min, hist_max, stats)) {
+    Rcpp::stop("Failed to create the reduction framebuffers.");
+  }
+  int width, height;
+  GetRenderSize(render_session->context, &width, &height);
+  double pixels = (double)width * height;
+  NumericVector min(3), max(3), sum(3), mean(3);
+  for(int c = 0; c < 3; c++) {
+    min[c] = stats.min[c];
+    max[c] = stats.max[c];
+    sum[c] = stats.sum[c];
+    mean[c] = stats.sum[c] / pixels;
+  }
+  NumericMatrix histogram(bins, 3);
+  std::copy(stats.histogram.begin(), stats.histogram.end(), histogram.begin());
+  return(List::create(Named("min") = min,
+                      Named("max") = max,
+                      Named("sum") = sum,
+                      Named("mean") = mean,
+                      Named("histogram") = histogram));
+}
+
+// [[Rcpp::export]]
+SEXP render_sweep_rcpp(SEXP session, const CharacterVector vertex_shader,
+                       const CharacterVector fragment_shader, int type,
+                       DataFrame params, CharacterVector filename,
+                       int readback_buffers, int encode_threads,
+                       int png_level, int png_filter, int compress_threads,
+                       int array_type) {
+  std::string filestring = Rcpp::as<std::string>(filename);
+  RenderSession* render_session = getSession(session);
+  CharacterVector names = params.names();
+  std::vector<SweepUniform> sweep(params.size());
+  int rows = 0;
+  for(int i = 0; i < (int)params.size(); i++) {
+    SEXP column = params[i];
+    sweep[i].name = Rcpp::as<std::string>(names[i]);
+    sweep[i].integer = TYPEOF(column) == INTSXP || TYPEOF(column) == LGLSXP;
+    NumericVector values(column);
+    sweep[i].values.assign(values.begin(), values.end());
+    rows = (int)values.size();
+  }
+  int width, height;
+  GetRenderSize(render_session->context, &width, &height);
+  std::unique_ptr<FrameStream> stream(NewFrameStream("", R_NilValue, 30, array_type,
+                                                     width, height, rows));
+  int rendered = render_session->renderFrames(vertex_shader, fragment_shader, type, FrameClock(),
+                                              rows, filestring, readback_buffers, encode_threads,
+                                              png_level, png_filter, compress_threads,
+                                              stream.get(), 0, &sweep, true);
+  if(rendered == 0) {
+    Rcpp::stop("Failed to build the shader program.");
+  }
+  if(stream) {
+    if(!stream->close()) {
+      Rcpp::stop(stream->error);
+    }
+    return(stream->result());
+  }
+  return(wrap(rendered));
+}
+
+// [[Rcpp::export]]
+void close_session_rcpp(SEXP session) {
+  XPtr<RenderSession> ptr(session);
+  if(ptr.get() != NULL) {
+    ptr->close();
+  }
+}
+
+// [[Rcpp::export]]
+List session_cache_stats_rcpp(SEXP session) {
+  RenderSession* render_session = getSession(session);
+  const ProgramCache& cache = render_session->programs;
+  return(List::create(Named("hits") = (double)cache.hits,
+                      Named("misses") = (double)cache.misses,
+                      Named("evictions") = (double)cache.evictions,
+                      Named("size") = (double)cache.size(),
+                      Named("capacity") = (double)cache.capacity,
+                      Named("frame_allocations") = (double)render_session->frame_allocations,
+                      Named("render_allocations") = (double)render_session->render_allocations,
+                      Named("frame_gl_calls") = render_session->frame_gl_calls));
+}
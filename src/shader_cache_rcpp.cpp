@@ -0,0 +1,12 @@
+#include <Rcpp.h>
+using namespace Rcpp;
+
+#include "loadshaders.h"
+#include <string>
+
+// [[Rcpp::export]]
+CharacterVector set_binary_cache_dir_rcpp(CharacterVector dir) {
+  CharacterVector previous = CharacterVector::create(GetProgramBinaryCacheDir());
+  SetProgramBinaryCacheDir(Rcpp::as<std::string>(dir));
+  return(previous);
+}
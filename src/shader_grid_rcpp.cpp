@@ -0,0 +1,34 @@
+#include <Rcpp.h>
+using namespace Rcpp;
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+#include "render_session.h"
+#include <string>
+#include <vector>
+
+// [[Rcpp::export]]
+NumericMatrix evaluate_grid_rcpp(SEXP session, const CharacterVector vertex_shader,
+                                 const CharacterVector fragment_shader,
+                                 List inputs, int nrow, int ncol) {
+  RenderSession* render_session = getSession(session);
+  std::string limit_error = render_session->gridLimitError((int)inputs.size(), nrow, ncol);
+  if(!limit_error.empty()) {
+    Rcpp::stop(limit_error);
+  }
+  //Textures hold 32-bit floats, in the same column-major order as R
+  std::vector<std::vector<float> > values(inputs.size());
+  for(int i = 0; i < (int)inputs.size(); i++) {
+    NumericVector input = inputs[i];
+    values[i].assign(input.begin(), input.end());
+  }
+  std::vector<float> output;
+  if(!render_session->evaluateGrid(vertex_shader, fragment_shader, values, nrow, ncol, output)) {
+    Rcpp::stop("Failed to evaluate the shader over the grid.");
+  }
+  NumericMatrix result(nrow, ncol);
+  std::copy(output.begin(), output.end(), result.begin());
+  return(result);
+}
@@ -0,0 +1,154 @@
+#include <Rcpp.h>
+
+#include "yuv_pass.h"
+#include "loadshaders.h"
+
+//A fullscreen triangle from gl_VertexID, so the pass needs no vertex buffers
+static const char* yuv_vertex_shader =
+  "#version 330 core\n"
+  "void main(){\n"
+  "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+  "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+//Fragment row r < height is luma row r (counted from the top of the frame);
+//row height + c holds chroma row c, U on the left half and V on the right.
+//The bilinear sample between four texels is the 2x2 average.
+static const char* yuv_fragment_shader =
+  "#version 330 core\n"
+  "uniform sampler2D frame;\n"
+  "uniform ivec2 size;\n"
+  "uniform bool full_range;\n"
+  "out float value;\n"
+  "const vec3 luma = vec3(0.2126, 0.7152, 0.0722);\n"
+  "void main(){\n"
+  "  ivec2 p = ivec2(gl_FragCoord.xy);\n"
+  "  if(p.y < size.y) {\n"
+  "    vec3 rgb = texelFetch(frame, ivec2(p.x, size.y - 1 - p.y), 0).rgb;\n"
+  "    float y = dot(luma, rgb);\n"
+  "    value = full_range ? y : (16.0 + 219.0 * y) / 255.0;\n"
+  "  } else {\n"
+  "    int half_width = size.x / 2;\n"
+  "    bool v = p.x >= half_width;\n"
+  "    vec2 center = vec2(2 * (v ? p.x - half_width : p.x) + 1, size.y - 2 * (p.y - size.y) - 1);\n"
+  "    vec3 rgb = texture(frame, center / vec2(size)).rgb;\n"
+  "    float y = dot(luma, rgb);\n"
+  "    float c = v ? (rgb.r - y) / 1.5748 : (rgb.b - y) / 1.8556;\n"
+  "    value = full_range ? c + 128.0 / 255.0 : (128.0 + 224.0 * c) / 255.0;\n"
+  "  }\n"
+  "}\n";
+
+bool YuvPass::create(int width, int height, bool full_range, bool verbose) {
+  if(program && width == this->width && height == this->height) {
+    this->full_range = full_range;
+    return(true);
+  }
+  destroy();
+  if(width % 2 != 0 || height % 2 != 0) {
+    Rcpp::Rcout << "YUV 4:2:0 frames need an even width and height (got " << width << "x" << height << ")\n";
+    return(false);
+  }
+  this->width = width;
+  this->height = height;
+  this->full_range = full_range;
+  program = LoadShaders(Rcpp::CharacterVector(yuv_vertex_shader),
+                        Rcpp::CharacterVector(yuv_fragment_shader), verbose);
+  if(!program) {
+    return(false);
+  }
+  GLint previous_framebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  frame_location = glGetUniformLocation(program, "frame");
+  size_location = glGetUniformLocation(program, "size");
+  range_location = glGetUniformLocation(program, "full_range");
+  glGenVertexArrays(1, &vertex_array);
+
+  //The rendered frame is copied here so it can be sampled
+  glGenTextures(1, &source_texture);
+  glBindTexture(GL_TEXTURE_2D, source_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glGenFramebuffers(1, &source_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, source_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source_texture, 0);
+
+  glGenRenderbuffers(1, &planes);
+  glBindRenderbuffer(GL_RENDERBUFFER, planes);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_R8, width, height * 3 / 2);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, planes);
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+  if(!complete) {
+    Rcpp::Rcout << "YUV framebuffer is incomplete\n";
+    destroy();
+    return(false);
+  }
+  return(true);
+}
+
+void YuvPass::destroy() {
+  if(!program) {
+    return;
+  }
+  glDeleteProgram(program);
+  glDeleteVertexArrays(1, &vertex_array);
+  glDeleteFramebuffers(1, &source_framebuffer);
+  glDeleteTextures(1, &source_texture);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &planes);
+  program = 0;
+  width = 0;
+  height = 0;
+}
+
+void YuvPass::convert(RenderContext& context) {
+  BindPresentedFrame(context);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, source_framebuffer);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  //The render loop sets its program and viewport once, so put them back
+  GLint previous_vertex_array = 0;
+  GLint previous_program = 0;
+  GLint previous_viewport[4];
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vertex_array);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  glGetIntegerv(GL_VIEWPORT, previous_viewport);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, width, height * 3 / 2);
+  glUseProgram(program);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source_texture);
+  glUniform1i(frame_location, 0);
+  glUniform2i(size_location, width, height);
+  glUniform1i(range_location, full_range ? 1 : 0);
+  glBindVertexArray(vertex_array);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(previous_vertex_array);
+  glUseProgram(previous_program);
+  glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+
+  if(context.target.framebuffer) {
+    BindRenderTarget(context.target);
+  } else {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+}
+
+void YuvPass::read(void* pixels) const {
+  size_t luma = (size_t)width * height;
+  int half_width = width / 2;
+  int half_height = height / 2;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+  glReadPixels(0, height, half_width, half_height, GL_RED, GL_UNSIGNED_BYTE,
+               (char*)pixels + luma);
+  glReadPixels(half_width, height, half_width, half_height, GL_RED, GL_UNSIGNED_BYTE,
+               (char*)pixels + luma + luma / 4);
+}
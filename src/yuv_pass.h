@@ -0,0 +1,48 @@
+#ifndef YUVPASSH
+#define YUVPASSH
+
+//glew Installed make install 
+#include <GL/glew.h>
+//GLWF3 Installed with cmake, make install 
+#include <GLFW/glfw3.h>
+
+#include "context.h"
+#include <cstddef>
+
+//Final render pass that converts a frame to planar YUV 4:2:0 (BT.709) on the
+//GPU, so only 1.5 bytes per pixel are read back and encoders get frames they
+//can use without a colorspace conversion. The planes are drawn into one
+//single-channel framebuffer, width x (height * 3/2): the Y plane, then rows
+//holding a U row on the left and a V row on the right, all top row first.
+//Chroma is the average of each 2x2 block, so width and height must be even.
+class YuvPass {
+public:
+  YuvPass() : width(0), height(0), full_range(false), program(0) {}
+  //(Re)creates the pass for width x height frames if it doesn't match.
+  //Limited range scales luma to 16-235 and chroma to 16-240.
+  bool create(int width, int height, bool full_range, bool verbose);
+  void destroy();
+  //Converts the frame just presented in `context` and binds the context's
+  //framebuffer for drawing again
+  void convert(RenderContext& context);
+  //Reads the planes (Y, U, V, each packed and top row first) into `pixels`,
+  //which is an offset when a pixel pack buffer is bound
+  void read(void* pixels) const;
+  size_t size() const { return (size_t)width * height * 3 / 2; }
+
+  int width;
+  int height;
+  bool full_range;
+private:
+  GLuint program;
+  GLuint vertex_array;
+  GLuint source_framebuffer;
+  GLuint source_texture;
+  GLuint framebuffer;
+  GLuint planes;
+  GLint frame_location;
+  GLint size_location;
+  GLint range_location;
+};
+
+#endif